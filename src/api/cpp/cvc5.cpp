@@ -6622,10 +6622,44 @@ Result Solver::modelCount(const std::vector<Sort>& sorts,
                           const std::vector<Term>& vars) const
 {
   CVC5_API_TRY_CATCH_BEGIN;
+  if (!getOption("dump-counting-cnf").empty())
+  {
+    // The bit-blaster writes its CNF instead of solving it
+    std::cout << "c dumping the projected CNF to "
+              << getOption("dump-counting-cnf") << std::endl;
+    internal::Result res = d_slv->checkSat();
+    if (res.getStatus() == internal::Result::UNSAT)
+    {
+      std::cout << "c formula is unsat after preprocessing, nothing dumped"
+                << std::endl;
+    }
+    return Result();
+  }
+  bool exactBlast = getOption("blast-exactmc") == "true";
+  if (getOption("blast-apxmc") == "true" || exactBlast)
+  {
+    // The counter counts the bit-blasted formula within the BV solver,
+    // projected on the bits of the --projcount variables.
+    std::string counter = exactBlast ? "ExactMC" : "ApproxMC";
+    std::cout << "c getting " << (exactBlast ? "exact" : "approximate")
+              << " count via " << counter << std::endl;
+    internal::Result res = d_slv->checkSat();
+    internal::Integer bbcount(0);
+    if (!d_slv->getBitblastModelCount(bbcount)
+        && res.getStatus() != internal::Result::UNSAT)
+    {
+      std::cout << "c " << counter
+                << " was not called, formula has no bit-vector part"
+                << std::endl;
+      return Result(res);
+    }
+    std::cout << "s mc " << bbcount << std::endl;
+    return Result();
+  }
   CVC5_API_CHECK(d_slv->getOptions().base.incrementalSolving)
       << "Cannot make multiple queries unless incremental solving is enabled "
          "(try --incremental)";
-  uint64_t count = 0;
+  internal::Integer count(0);
   bool exactcount = false;
   if (getOption("countenum") == "true" && !(getOption("smtapxmc") == "true"))
     exactcount = true;
@@ -6636,7 +6670,7 @@ Result Solver::modelCount(const std::vector<Sort>& sorts,
   if (exactcount)
   {
     std::cout << "c getting count by enumeration" << std::endl;
-    count = d_slv->boundedSat(0,0,smap->get_projection_nodes());
+    count = d_slv->enumerateCubes(smap->get_projection_nodes());
   }
   else
   {
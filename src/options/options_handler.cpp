@@ -297,7 +297,8 @@ void OptionsHandler::checkBvSatSolver(const std::string& flag, SatSolverMode m)
 
   if (d_options->bv.bvSolver != options::BVSolver::BITBLAST
       && (m == SatSolverMode::CRYPTOMINISAT || m == SatSolverMode::CADICAL
-          || m == SatSolverMode::APPROXMC || m == SatSolverMode::KISSAT))
+          || m == SatSolverMode::APPROXMC || m == SatSolverMode::EXACTMC
+          || m == SatSolverMode::DUMP || m == SatSolverMode::KISSAT))
   {
     if (d_options->bv.bitblastMode == options::BitblastMode::LAZY
         && d_options->bv.bitblastModeWasSetByUser)
@@ -311,6 +312,14 @@ void OptionsHandler::checkBvSatSolver(const std::string& flag, SatSolverMode m)
       {
         sat_solver = "ApproxMC";
       }
+      else if (m == options::SatSolverMode::EXACTMC)
+      {
+        sat_solver = "ExactMC";
+      }
+      else if (m == options::SatSolverMode::DUMP)
+      {
+        sat_solver = "The CNF dump";
+      }
       else if (m == options::SatSolverMode::KISSAT)
       {
         sat_solver = "Kissat";
@@ -398,7 +398,10 @@ void CheckSatCommand::invoke(cvc5::Solver* solver, SymbolManager* sm)
   {
     bool count = false;
     if (solver->getOption("countenum") == "true"
-        || solver->getOption("smtapxmc") == "true")
+        || solver->getOption("smtapxmc") == "true"
+        || solver->getOption("blast-apxmc") == "true"
+        || solver->getOption("blast-exactmc") == "true"
+        || !solver->getOption("dump-counting-cnf").empty())
       count = true;
     if (count)
     {
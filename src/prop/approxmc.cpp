@@ -23,6 +23,7 @@
 #include <bits/stdc++.h>
 
 #include "base/check.h"
+#include "base/exception.h"
 #include "util/resource_manager.h"
 #include "util/statistics_registry.h"
 
@@ -59,6 +60,7 @@ void toInternalClause(SatClause& clause,
 ApproxMCounter::ApproxMCounter(StatisticsRegistry& registry,
                                const std::string& name)
     : d_counter(new ApproxMC::AppMC()),
+      d_hasCount(false),
       d_numVariables(0),
       d_okay(true),
       d_statistics(registry, name),
@@ -135,6 +137,18 @@ ClauseId ApproxMCounter::addClause(SatClause& clause, bool removable)
 
 bool ApproxMCounter::ok() const { return d_okay; }
 
+void ApproxMCounter::setSamplingSet(const std::vector<SatVariable>& vars)
+{
+  d_samplingSet = vars;
+}
+
+bool ApproxMCounter::getModelCount(Integer& count) const
+{
+  if (!d_hasCount) return false;
+  count = d_count;
+  return true;
+}
+
 SatVariable ApproxMCounter::newVar(bool isTheoryAtom,
                                    bool canErase)
 {
@@ -157,7 +171,16 @@ SatValue ApproxMCounter::solve()
 {
   TimerStat::CodeTimer codeTimer(d_statistics.d_solveTime);
   ++d_statistics.d_statCallsToSolve;
-  std::cout << "Calling ApproxMC..." << std::endl;
+  if (!d_samplingSet.empty())
+  {
+    // Without a sampling set ApproxMC counts over all variables, including
+    // the Tseitin and bit-blasting auxiliaries.
+    std::vector<uint32_t> projection(d_samplingSet.begin(),
+                                     d_samplingSet.end());
+    d_counter->set_projection_set(projection);
+  }
+  std::cout << "Calling ApproxMC on " << d_samplingSet.size()
+            << " sampling set variables..." << std::endl;
   d_counter->set_verbosity(1);
   ApproxMC::SolCount solcount = d_counter->count();
   std::cout << "ApproxMC called" << std::endl;
@@ -165,10 +188,8 @@ SatValue ApproxMCounter::solve()
   // set_verbosity
   std::cout << "[ApproxMC] Count = " << solcount.cellSolCount << "*2**"
             << solcount.hashCount << std::endl;
-  std::cout << "s mc "
-            << (long long int)(solcount.cellSolCount
-                               * (long long int)pow(2, solcount.hashCount))
-            << std::endl;
+  d_count = Integer(solcount.cellSolCount).multiplyByPow2(solcount.hashCount);
+  d_hasCount = true;
   return SAT_VALUE_UNKNOWN;
 }
 
@@ -182,16 +203,33 @@ SatValue ApproxMCounter::solve(long unsigned int& resource)
 
 SatValue ApproxMCounter::solve(const std::vector<SatLiteral>& assumptions)
 {
-  std::cout << "[ApproxMC] called with assumptions" << std::endl;
-  std::vector<CMSat::Lit> assumpts;
+  // ApproxMC has no interface for assumptions, so they are added as unit
+  // clauses, which stay in the counter. A later call may add assumptions,
+  // but it can not drop any, since the count would still be made under it.
+  for (const SatLiteral& lit : d_assumptions)
+  {
+    if (std::find(assumptions.begin(), assumptions.end(), lit)
+        == assumptions.end())
+    {
+      throw Exception(
+          "ApproxMC can not count under assumptions that drop an assumption "
+          "of an earlier count");
+    }
+  }
+  std::vector<CMSat::Lit> unit(1);
   for (const SatLiteral& lit : assumptions)
   {
-    assumpts.push_back(toInternalLit(lit));
+    if (std::find(d_assumptions.begin(), d_assumptions.end(), lit)
+        != d_assumptions.end())
+    {
+      continue;
+    }
+    Trace("sat::cryptominisat") << "Adding assumption " << lit << " as unit\n";
+    unit[0] = toInternalLit(lit);
+    d_counter->add_clause(unit);
+    d_assumptions.push_back(lit);
   }
-  ++d_statistics.d_statCallsToSolve;
-  std::cout << "[ApproxMC] Skipping " << assumpts.size()
-            << " assumptions (TODO?)" << std::endl;
-  return solve();  // TODO decide what is to be done here.
+  return solve();
 }
 
 void ApproxMCounter::getUnsatAssumptions(std::vector<SatLiteral>& assumptions)
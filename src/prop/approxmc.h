@@ -62,6 +62,10 @@ class ApproxMCounter : public SatSolver
 
   bool ok() const override;
 
+  void setSamplingSet(const std::vector<SatVariable>& vars) override;
+
+  bool getModelCount(Integer& count) const override;
+
  private:
   /**
    * Private to disallow creation outside of SatSolverFactory.
@@ -82,11 +86,18 @@ class ApproxMCounter : public SatSolver
   std::unique_ptr<ApproxMC::AppMC> d_counter;
 
   /**
-   * Stores the current set of assumptions provided via solve() and is used to
-   * query the solver if a given assumption is false.
+   * The assumptions of the calls to solve() so far, which were added to the
+   * counter as unit clauses.
    */
   std::vector<SatLiteral> d_assumptions;
 
+  /** The variables the count is projected on, all variables if empty. */
+  std::vector<SatVariable> d_samplingSet;
+
+  /** The count of the last call to solve(), if d_hasCount. */
+  Integer d_count;
+  bool d_hasCount;
+
   unsigned d_nextVarIdx;
   bool d_inSatMode;
   SatVariable d_true;
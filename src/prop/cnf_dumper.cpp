@@ -0,0 +1,180 @@
+/******************************************************************************
+ * Top contributors (to current version):
+ *   Arijit Shaw
+ *
+ * This file is part of the cvc5 project.
+ *
+ * Copyright (c) 2009-2022 by the authors listed in the file AUTHORS
+ * in the top-level source directory and their institutional affiliations.
+ * All rights reserved.  See the file COPYING in the top-level source
+ * directory for licensing information.
+ * ****************************************************************************
+ *
+ * Back end of the bit-blaster that writes the projected CNF to a file.
+ */
+
+#include "prop/cnf_dumper.h"
+
+#include <algorithm>
+#include <fstream>
+#include <iostream>
+
+#include "base/check.h"
+#include "base/exception.h"
+#include "base/output.h"
+#include "util/statistics_registry.h"
+
+namespace cvc5::internal {
+namespace prop {
+
+CnfDumper::CnfDumper(StatisticsRegistry& registry,
+                     const std::string& filename,
+                     const std::string& name)
+    : d_filename(filename), d_numVariables(0), d_statistics(registry, name)
+{
+}
+
+void CnfDumper::init()
+{
+  d_true = newVar();
+  d_false = newVar();
+
+  SatClause clause(1);
+  clause[0] = SatLiteral(d_true, false);
+  addClause(clause, false);
+
+  clause[0] = SatLiteral(d_false, true);
+  addClause(clause, false);
+}
+
+CnfDumper::~CnfDumper() {}
+
+ClauseId CnfDumper::addXorClause(SatClause& clause, bool rhs, bool removable)
+{
+  Unreachable() << "CnfDumper does not support XOR clauses";
+  return ClauseIdError;
+}
+
+ClauseId CnfDumper::addClause(SatClause& clause, bool removable)
+{
+  Trace("sat::cnfdump") << "Add clause " << clause << "\n";
+  ++(d_statistics.d_clausesAdded);
+  std::vector<int64_t> c;
+  for (const SatLiteral& lit : clause)
+  {
+    int64_t v = static_cast<int64_t>(lit.getSatVariable()) + 1;
+    c.push_back(lit.isNegated() ? -v : v);
+  }
+  d_clauses.push_back(c);
+  return ClauseIdError;
+}
+
+bool CnfDumper::ok() const { return true; }
+
+void CnfDumper::setSamplingSet(const std::vector<SatVariable>& vars)
+{
+  d_samplingSet = vars;
+}
+
+SatVariable CnfDumper::newVar(bool isTheoryAtom, bool canErase)
+{
+  return d_numVariables++;
+}
+
+SatVariable CnfDumper::trueVar() { return d_true; }
+
+SatVariable CnfDumper::falseVar() { return d_false; }
+
+void CnfDumper::interrupt() {}
+
+SatValue CnfDumper::solve()
+{
+  write({});
+  return SAT_VALUE_UNKNOWN;
+}
+
+void CnfDumper::write(const std::vector<SatLiteral>& assumptions)
+{
+  std::ofstream file;
+  if (d_filename != "-")
+  {
+    file.open(d_filename);
+    if (!file)
+    {
+      throw Exception("Cannot open " + d_filename + " to dump the CNF");
+    }
+  }
+  std::ostream& out = d_filename == "-" ? std::cout : file;
+  // The sampling set is given both as "c ind" lines (ApproxMC, UniGen) and
+  // as a "c p show" line (GANAK, d4).
+  if (!d_samplingSet.empty())
+  {
+    for (size_t i = 0, n = d_samplingSet.size(); i < n; i += 10)
+    {
+      out << "c ind";
+      for (size_t j = i; j < std::min(i + 10, n); ++j)
+      {
+        out << " " << d_samplingSet[j] + 1;
+      }
+      out << " 0\n";
+    }
+    out << "c p show";
+    for (SatVariable v : d_samplingSet)
+    {
+      out << " " << v + 1;
+    }
+    out << " 0\n";
+  }
+  size_t num_clauses = d_clauses.size() + assumptions.size();
+  out << "p cnf " << d_numVariables << " " << num_clauses << "\n";
+  for (const std::vector<int64_t>& c : d_clauses)
+  {
+    for (int64_t lit : c)
+    {
+      out << lit << " ";
+    }
+    out << "0\n";
+  }
+  for (const SatLiteral& lit : assumptions)
+  {
+    int64_t v = static_cast<int64_t>(lit.getSatVariable()) + 1;
+    out << (lit.isNegated() ? -v : v) << " 0\n";
+  }
+  out.flush();
+  ++(d_statistics.d_filesWritten);
+  std::cout << "c wrote " << num_clauses << " clauses over " << d_numVariables
+            << " variables (" << d_samplingSet.size()
+            << " in the sampling set) to " << d_filename << std::endl;
+}
+
+SatValue CnfDumper::solve(long unsigned int& resource) { return solve(); }
+
+SatValue CnfDumper::solve(const std::vector<SatLiteral>& assumptions)
+{
+  // The assumptions are the asserted facts, written as unit clauses of this
+  // dump only.
+  write(assumptions);
+  return SAT_VALUE_UNKNOWN;
+}
+
+void CnfDumper::getUnsatAssumptions(std::vector<SatLiteral>& assumptions) {}
+
+SatValue CnfDumper::value(SatLiteral l) { return SAT_VALUE_UNKNOWN; }
+
+SatValue CnfDumper::modelValue(SatLiteral l) { return value(l); }
+
+unsigned CnfDumper::getAssertionLevel() const
+{
+  Unreachable() << "No interface to get assertion level in CnfDumper";
+  return -1;
+}
+
+CnfDumper::Statistics::Statistics(StatisticsRegistry& registry,
+                                  const std::string& prefix)
+    : d_clausesAdded(registry.registerInt(prefix + "cnfdump::clauses")),
+      d_filesWritten(registry.registerInt(prefix + "cnfdump::files"))
+{
+}
+
+}  // namespace prop
+}  // namespace cvc5::internal
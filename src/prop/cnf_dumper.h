@@ -0,0 +1,111 @@
+/******************************************************************************
+ * Top contributors (to current version):
+ *   Arijit Shaw
+ *
+ * This file is part of the cvc5 project.
+ *
+ * Copyright (c) 2009-2022 by the authors listed in the file AUTHORS
+ * in the top-level source directory and their institutional affiliations.
+ * All rights reserved.  See the file COPYING in the top-level source
+ * directory for licensing information.
+ * ****************************************************************************
+ *
+ * Back end of the bit-blaster that writes the projected CNF to a file.
+ *
+ * Used by --dump-counting-cnf to hand the bit-blasted formula and its
+ * sampling set to external model counters.
+ */
+
+#include "cvc5_private.h"
+
+#ifndef CVC5__PROP__CNF_DUMPER_H
+#define CVC5__PROP__CNF_DUMPER_H
+
+#include <string>
+#include <vector>
+
+#include "prop/sat_solver.h"
+
+namespace cvc5::internal {
+namespace prop {
+
+class CnfDumper : public SatSolver
+{
+  friend class SatSolverFactory;
+
+ public:
+  ~CnfDumper() override;
+
+  ClauseId addClause(SatClause& clause, bool removable) override;
+
+  ClauseId addXorClause(SatClause& clause, bool rhs, bool removable) override;
+
+  SatVariable newVar(bool isTheoryAtom = false,
+                     bool canErase = true) override;
+
+  SatVariable trueVar() override;
+
+  SatVariable falseVar() override;
+
+  SatValue solve() override;
+  SatValue solve(long unsigned int&) override;
+  SatValue solve(const std::vector<SatLiteral>& assumptions) override;
+  void getUnsatAssumptions(std::vector<SatLiteral>& assumptions) override;
+
+  void interrupt() override;
+
+  SatValue value(SatLiteral l) override;
+
+  SatValue modelValue(SatLiteral l) override;
+
+  unsigned getAssertionLevel() const override;
+
+  bool ok() const override;
+
+  void setSamplingSet(const std::vector<SatVariable>& vars) override;
+
+ private:
+  /**
+   * Private to disallow creation outside of SatSolverFactory.
+   * Function init() must be called after creation.
+   */
+  CnfDumper(StatisticsRegistry& registry,
+            const std::string& filename,
+            const std::string& name = "");
+  /**
+   * Initialize SAT solver instance.
+   * Note: Split out to not call virtual functions in constructor.
+   */
+  void init();
+  /**
+   * Write the clauses and the given assumptions, as unit clauses, to the
+   * file (standard output for "-").
+   */
+  void write(const std::vector<SatLiteral>& assumptions);
+
+  /** The file the CNF is written to by solve(), "-" for standard output. */
+  std::string d_filename;
+  /** The clauses, with literals v + 1 or -(v + 1) for variable v. */
+  std::vector<std::vector<int64_t>> d_clauses;
+  /** The variables the count is projected on, all variables if empty. */
+  std::vector<SatVariable> d_samplingSet;
+
+  SatVariable d_true;
+  SatVariable d_false;
+
+  class Statistics
+  {
+   public:
+    IntStat d_clausesAdded;
+    IntStat d_filesWritten;
+    Statistics(StatisticsRegistry& registry, const std::string& prefix);
+  };
+
+  unsigned d_numVariables;
+  Statistics d_statistics;
+};
+
+}  // namespace prop
+}  // namespace cvc5::internal
+
+#endif  // CVC5__PROP__CNF_DUMPER_H
@@ -0,0 +1,529 @@
+/******************************************************************************
+ * Top contributors (to current version):
+ *   Arijit Shaw
+ *
+ * This file is part of the cvc5 project.
+ *
+ * Copyright (c) 2009-2022 by the authors listed in the file AUTHORS
+ * in the top-level source directory and their institutional affiliations.
+ * All rights reserved.  See the file COPYING in the top-level source
+ * directory for licensing information.
+ * ****************************************************************************
+ *
+ * Exact projected model counter for the bit-blasted CNF.
+ */
+
+#include "prop/exact_counter.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <iostream>
+#include <numeric>
+#include <unordered_set>
+
+#include "base/check.h"
+#include "base/exception.h"
+#include "base/output.h"
+#include "util/statistics_registry.h"
+
+namespace cvc5::internal {
+namespace prop {
+
+namespace {
+
+int toLit(SatLiteral lit)
+{
+  int v = static_cast<int>(lit.getSatVariable()) + 1;
+  return lit.isNegated() ? -v : v;
+}
+
+uint32_t litVar(int lit) { return static_cast<uint32_t>(std::abs(lit)) - 1; }
+
+/** Index of a literal in the watch lists. */
+size_t litIndex(int lit) { return 2 * litVar(lit) + (lit < 0 ? 1 : 0); }
+
+}  // namespace
+
+size_t ExactCounter::KeyHash::operator()(
+    const std::vector<uint32_t>& key) const
+{
+  size_t h = key.size();
+  for (uint32_t x : key)
+  {
+    h ^= std::hash<uint32_t>()(x) + 0x9e3779b9 + (h << 6) + (h >> 2);
+  }
+  return h;
+}
+
+ExactCounter::ExactCounter(StatisticsRegistry& registry,
+                           const std::string& name)
+    : d_depth(0),
+      d_qhead(0),
+      d_hasCount(false),
+      d_numVariables(0),
+      d_okay(true),
+      d_statistics(registry, name)
+{
+}
+
+void ExactCounter::init()
+{
+  d_true = newVar();
+  d_false = newVar();
+
+  SatClause clause(1);
+  clause[0] = SatLiteral(d_true, false);
+  addClause(clause, false);
+
+  clause[0] = SatLiteral(d_false, true);
+  addClause(clause, false);
+}
+
+ExactCounter::~ExactCounter() {}
+
+ClauseId ExactCounter::addXorClause(SatClause& clause,
+                                    bool rhs,
+                                    bool removable)
+{
+  Unreachable() << "ExactCounter does not support XOR clauses";
+  return ClauseIdError;
+}
+
+ClauseId ExactCounter::addClause(SatClause& clause, bool removable)
+{
+  Trace("sat::exactmc") << "Add clause " << clause << "\n";
+  ++(d_statistics.d_clausesAdded);
+  std::vector<int> c;
+  for (const SatLiteral& lit : clause)
+  {
+    c.push_back(toLit(lit));
+  }
+  // The two watched literals must be distinct variables, so duplicate
+  // literals are removed, and a tautology is left out since it is always
+  // satisfied.
+  std::sort(c.begin(), c.end(), [](int a, int b) {
+    return std::abs(a) < std::abs(b) || (std::abs(a) == std::abs(b) && a < b);
+  });
+  c.erase(std::unique(c.begin(), c.end()), c.end());
+  for (size_t i = 1, n = c.size(); i < n; ++i)
+  {
+    if (litVar(c[i - 1]) == litVar(c[i])) return ClauseIdError;
+  }
+  if (c.empty())
+  {
+    d_okay = false;
+    return ClauseIdError;
+  }
+  d_clauses.push_back(c);
+  return ClauseIdError;
+}
+
+bool ExactCounter::ok() const { return d_okay; }
+
+void ExactCounter::setSamplingSet(const std::vector<SatVariable>& vars)
+{
+  d_samplingSet = vars;
+}
+
+bool ExactCounter::getModelCount(Integer& count) const
+{
+  if (!d_hasCount) return false;
+  count = d_count;
+  return true;
+}
+
+SatVariable ExactCounter::newVar(bool isTheoryAtom, bool canErase)
+{
+  return d_numVariables++;
+}
+
+SatVariable ExactCounter::trueVar() { return d_true; }
+
+SatVariable ExactCounter::falseVar() { return d_false; }
+
+void ExactCounter::interrupt()
+{
+  Unreachable() << "ExactCounter can not be interrupted";
+}
+
+int8_t ExactCounter::litValue(int lit) const
+{
+  int8_t v = d_assign[litVar(lit)];
+  return lit > 0 ? v : -v;
+}
+
+void ExactCounter::assign(int lit)
+{
+  uint32_t var = litVar(lit);
+  Assert(d_assign[var] == 0);
+  d_assign[var] = lit > 0 ? 1 : -1;
+  d_trail.push_back(lit);
+}
+
+void ExactCounter::undo(size_t mark)
+{
+  while (d_trail.size() > mark)
+  {
+    d_assign[litVar(d_trail.back())] = 0;
+    d_trail.pop_back();
+  }
+  // The trail up to mark was propagated when mark was taken
+  d_qhead = std::min(d_qhead, mark);
+}
+
+bool ExactCounter::propagate()
+{
+  // Each clause watches its first two literals. A clause only needs to be
+  // visited when one of them becomes false: it then watches another literal
+  // that is not false, or it is unit on the other watched literal, or it is
+  // a conflict. Watches stay valid on undo, so nothing is restored.
+  while (d_qhead < d_trail.size())
+  {
+    int false_lit = -d_trail[d_qhead++];
+    std::vector<uint32_t>& watches = d_watches[litIndex(false_lit)];
+    size_t i = 0, j = 0, n = watches.size();
+    bool conflict = false;
+    for (; i < n; ++i)
+    {
+      uint32_t ci = watches[i];
+      std::vector<int>& c = d_clauses[ci];
+      if (c[0] == false_lit) std::swap(c[0], c[1]);
+      Assert(c[1] == false_lit);
+      if (conflict || litValue(c[0]) > 0)
+      {
+        watches[j++] = ci;
+        continue;
+      }
+      bool moved = false;
+      for (size_t k = 2, size = c.size(); k < size; ++k)
+      {
+        if (litValue(c[k]) >= 0)
+        {
+          std::swap(c[1], c[k]);
+          d_watches[litIndex(c[1])].push_back(ci);
+          moved = true;
+          break;
+        }
+      }
+      if (moved) continue;
+      watches[j++] = ci;
+      if (litValue(c[0]) == 0)
+      {
+        assign(c[0]);
+      }
+      else
+      {
+        conflict = true;
+      }
+    }
+    watches.resize(j);
+    if (conflict) return false;
+  }
+  return true;
+}
+
+void ExactCounter::residual(const std::vector<uint32_t>& clauses,
+                            std::vector<uint32_t>& rest) const
+{
+  for (uint32_t ci : clauses)
+  {
+    const std::vector<int>& c = d_clauses[ci];
+    if (std::none_of(c.begin(), c.end(), [this](int lit) {
+          return litValue(lit) > 0;
+        }))
+    {
+      rest.push_back(ci);
+    }
+  }
+}
+
+void ExactCounter::components(const std::vector<uint32_t>& clauses,
+                              std::vector<std::vector<uint32_t>>& comps)
+{
+  auto find = [this](uint32_t v) {
+    while (d_parent[v] != v)
+    {
+      d_parent[v] = d_parent[d_parent[v]];
+      v = d_parent[v];
+    }
+    return v;
+  };
+  // every variable of a clause is joined to its first unassigned variable
+  std::vector<uint32_t> first(clauses.size());
+  for (size_t i = 0, n = clauses.size(); i < n; ++i)
+  {
+    bool has_first = false;
+    for (int lit : d_clauses[clauses[i]])
+    {
+      if (litValue(lit) != 0) continue;
+      uint32_t v = litVar(lit);
+      if (!has_first)
+      {
+        first[i] = v;
+        has_first = true;
+        continue;
+      }
+      uint32_t a = find(first[i]), b = find(v);
+      if (a != b) d_parent[b] = a;
+    }
+    Assert(has_first);
+  }
+  std::unordered_map<uint32_t, size_t> comp_of;
+  for (size_t i = 0, n = clauses.size(); i < n; ++i)
+  {
+    uint32_t root = find(first[i]);
+    auto it = comp_of.find(root);
+    if (it == comp_of.end())
+    {
+      it = comp_of.emplace(root, comps.size()).first;
+      comps.emplace_back();
+    }
+    comps[it->second].push_back(clauses[i]);
+  }
+  // reset the parents of the variables that were touched
+  for (uint32_t ci : clauses)
+  {
+    for (int lit : d_clauses[ci])
+    {
+      d_parent[litVar(lit)] = litVar(lit);
+    }
+  }
+  d_statistics.d_components += comps.size();
+}
+
+uint32_t ExactCounter::numFree(const std::vector<uint32_t>& vars,
+                               const std::vector<uint32_t>& clauses)
+{
+  std::unordered_set<uint32_t> occurring;
+  for (uint32_t ci : clauses)
+  {
+    for (int lit : d_clauses[ci])
+    {
+      if (litValue(lit) == 0) occurring.insert(litVar(lit));
+    }
+  }
+  uint32_t free = 0;
+  for (uint32_t v : vars)
+  {
+    if (d_projected[v] && d_assign[v] == 0
+        && occurring.find(v) == occurring.end())
+    {
+      ++free;
+    }
+  }
+  return free;
+}
+
+Integer ExactCounter::countResidual(const std::vector<uint32_t>& clauses,
+                                   const std::vector<uint32_t>& vars)
+{
+  std::vector<std::vector<uint32_t>> comps;
+  components(clauses, comps);
+  Integer count(1);
+  for (const std::vector<uint32_t>& comp : comps)
+  {
+    count *= countComponent(comp);
+    if (count.isZero()) return count;
+  }
+  return count.multiplyByPow2(numFree(vars, clauses));
+}
+
+Integer ExactCounter::countComponent(const std::vector<uint32_t>& clauses)
+{
+  // The unsatisfied clauses of a component only keep their unassigned
+  // literals, so the count is determined by the ids of its clauses and the
+  // variables of them that are unassigned.
+  std::vector<uint32_t> key(clauses.begin(), clauses.end());
+  std::sort(key.begin(), key.end());
+  std::unordered_map<uint32_t, uint32_t> occurrences;
+  for (uint32_t ci : clauses)
+  {
+    for (int lit : d_clauses[ci])
+    {
+      if (litValue(lit) != 0) continue;
+      ++occurrences[litVar(lit)];
+    }
+  }
+  size_t num_clauses = key.size();
+  for (const std::pair<const uint32_t, uint32_t>& p : occurrences)
+  {
+    key.push_back(p.first);
+  }
+  std::sort(key.begin() + num_clauses, key.end());
+  // Clause ids and variables can be equal, so the boundary is part of the key
+  key.push_back(static_cast<uint32_t>(num_clauses));
+  auto it = d_cache.find(key);
+  if (it != d_cache.end())
+  {
+    ++(d_statistics.d_cacheHits);
+    return it->second;
+  }
+
+  // Branch on the most frequent projected variable, and only on the other
+  // variables once no projected one is left.
+  std::vector<uint32_t> vars;
+  uint32_t best = 0;
+  bool best_projected = false;
+  uint32_t best_occ = 0;
+  for (const std::pair<const uint32_t, uint32_t>& p : occurrences)
+  {
+    vars.push_back(p.first);
+    bool projected = d_projected[p.first];
+    if ((projected && !best_projected)
+        || (projected == best_projected && p.second > best_occ))
+    {
+      best = p.first;
+      best_projected = projected;
+      best_occ = p.second;
+    }
+  }
+
+  if (d_depth >= s_maxDepth)
+  {
+    throw Exception("ExactMC: the search exceeds "
+                    + std::to_string(s_maxDepth) + " nested decisions");
+  }
+  ++d_depth;
+  Integer total(0);
+  for (int lit : {static_cast<int>(best) + 1, -static_cast<int>(best) - 1})
+  {
+    size_t mark = d_trail.size();
+    assign(lit);
+    Integer count(0);
+    if (propagate())
+    {
+      std::vector<uint32_t> rest;
+      residual(clauses, rest);
+      count = countResidual(rest, vars);
+    }
+    undo(mark);
+    if (best_projected)
+    {
+      total += count;
+    }
+    else if (!count.isZero())
+    {
+      // satisfiable, and there is no projected variable to count
+      total = Integer(1);
+      break;
+    }
+  }
+  --d_depth;
+  d_cache.emplace(std::move(key), total);
+  return total;
+}
+
+SatValue ExactCounter::solve()
+{
+  count({});
+  return SAT_VALUE_UNKNOWN;
+}
+
+void ExactCounter::count(const std::vector<SatLiteral>& assumptions)
+{
+  TimerStat::CodeTimer codeTimer(d_statistics.d_solveTime);
+  ++d_statistics.d_statCallsToSolve;
+  d_assign.assign(d_numVariables, 0);
+  d_trail.clear();
+  d_qhead = 0;
+  d_depth = 0;
+  d_parent.resize(d_numVariables);
+  std::iota(d_parent.begin(), d_parent.end(), 0);
+  d_cache.clear();
+  // Without a sampling set the count is over all variables, including the
+  // Tseitin and bit-blasting auxiliaries.
+  d_projected.assign(d_numVariables, d_samplingSet.empty());
+  for (SatVariable v : d_samplingSet)
+  {
+    d_projected[v] = true;
+  }
+
+  std::vector<uint32_t> all(d_clauses.size());
+  std::iota(all.begin(), all.end(), 0);
+  std::vector<uint32_t> vars(d_numVariables);
+  std::iota(vars.begin(), vars.end(), 0);
+  d_count = Integer(0);
+  // Unit clauses are assigned up front, the others watch their first two
+  // literals. The assumptions are fixed like unit clauses, but only for
+  // this count.
+  d_watches.assign(2 * d_numVariables, {});
+  std::vector<int> units;
+  for (uint32_t ci : all)
+  {
+    const std::vector<int>& c = d_clauses[ci];
+    if (c.size() == 1)
+    {
+      units.push_back(c[0]);
+      continue;
+    }
+    d_watches[litIndex(c[0])].push_back(ci);
+    d_watches[litIndex(c[1])].push_back(ci);
+  }
+  for (const SatLiteral& lit : assumptions)
+  {
+    units.push_back(toLit(lit));
+  }
+  bool consistent = d_okay;
+  for (int l : units)
+  {
+    int8_t v = litValue(l);
+    if (v < 0)
+    {
+      consistent = false;
+      break;
+    }
+    if (v == 0) assign(l);
+  }
+  if (consistent && propagate())
+  {
+    std::vector<uint32_t> rest;
+    residual(all, rest);
+    d_count = countResidual(rest, vars);
+  }
+  undo(0);
+  d_hasCount = true;
+  std::cout << "[ExactMC] Count = " << d_count << " (" << d_cache.size()
+            << " cached components)" << std::endl;
+}
+
+SatValue ExactCounter::solve(long unsigned int& resource)
+{
+  Unreachable() << "ExactCounter does not support resource limits";
+  return solve();
+}
+
+SatValue ExactCounter::solve(const std::vector<SatLiteral>& assumptions)
+{
+  // The count is the count of the formula under the assumptions, which do
+  // not constrain later calls.
+  count(assumptions);
+  return SAT_VALUE_UNKNOWN;
+}
+
+void ExactCounter::getUnsatAssumptions(std::vector<SatLiteral>& assumptions)
+{
+}
+
+SatValue ExactCounter::value(SatLiteral l) { return SAT_VALUE_UNKNOWN; }
+
+SatValue ExactCounter::modelValue(SatLiteral l) { return value(l); }
+
+unsigned ExactCounter::getAssertionLevel() const
+{
+  Unreachable() << "No interface to get assertion level in ExactCounter";
+  return -1;
+}
+
+ExactCounter::Statistics::Statistics(StatisticsRegistry& registry,
+                                     const std::string& prefix)
+    : d_statCallsToSolve(
+        registry.registerInt(prefix + "exactmc::calls_to_solve")),
+      d_clausesAdded(registry.registerInt(prefix + "exactmc::clauses")),
+      d_components(registry.registerInt(prefix + "exactmc::components")),
+      d_cacheHits(registry.registerInt(prefix + "exactmc::cache_hits")),
+      d_solveTime(registry.registerTimer(prefix + "exactmc::solve_time"))
+{
+}
+
+}  // namespace prop
+}  // namespace cvc5::internal
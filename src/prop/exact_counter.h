@@ -0,0 +1,188 @@
+/******************************************************************************
+ * Top contributors (to current version):
+ *   Arijit Shaw
+ *
+ * This file is part of the cvc5 project.
+ *
+ * Copyright (c) 2009-2022 by the authors listed in the file AUTHORS
+ * in the top-level source directory and their institutional affiliations.
+ * All rights reserved.  See the file COPYING in the top-level source
+ * directory for licensing information.
+ * ****************************************************************************
+ *
+ * Exact projected model counter for the bit-blasted CNF.
+ *
+ * A DPLL-style counter with connected component decomposition and a cache
+ * of component counts, used as the SAT back end of the bit-blaster with
+ * --blast-exactmc.
+ */
+
+#include "cvc5_private.h"
+
+#ifndef CVC5__PROP__EXACT_COUNTER_H
+#define CVC5__PROP__EXACT_COUNTER_H
+
+#include <unordered_map>
+#include <vector>
+
+#include "prop/sat_solver.h"
+
+namespace cvc5::internal {
+namespace prop {
+
+class ExactCounter : public SatSolver
+{
+  friend class SatSolverFactory;
+
+ public:
+  ~ExactCounter() override;
+
+  ClauseId addClause(SatClause& clause, bool removable) override;
+
+  ClauseId addXorClause(SatClause& clause, bool rhs, bool removable) override;
+
+  SatVariable newVar(bool isTheoryAtom = false,
+                     bool canErase = true) override;
+
+  SatVariable trueVar() override;
+
+  SatVariable falseVar() override;
+
+  SatValue solve() override;
+  SatValue solve(long unsigned int&) override;
+  SatValue solve(const std::vector<SatLiteral>& assumptions) override;
+  void getUnsatAssumptions(std::vector<SatLiteral>& assumptions) override;
+
+  void interrupt() override;
+
+  SatValue value(SatLiteral l) override;
+
+  SatValue modelValue(SatLiteral l) override;
+
+  unsigned getAssertionLevel() const override;
+
+  bool ok() const override;
+
+  void setSamplingSet(const std::vector<SatVariable>& vars) override;
+
+  bool getModelCount(Integer& count) const override;
+
+ private:
+  /**
+   * Private to disallow creation outside of SatSolverFactory.
+   * Function init() must be called after creation.
+   */
+  ExactCounter(StatisticsRegistry& registry, const std::string& name = "");
+  /**
+   * Initialize SAT solver instance.
+   * Note: Split out to not call virtual functions in constructor.
+   */
+  void init();
+
+  /** Hash of a component key. */
+  struct KeyHash
+  {
+    size_t operator()(const std::vector<uint32_t>& key) const;
+  };
+
+  /** Value of a literal (DIMACS style) under d_assign: 1, -1 or 0. */
+  int8_t litValue(int lit) const;
+  /** Assign lit to true and record it on the trail. */
+  void assign(int lit);
+  /** Unassign the variables assigned after the trail had size mark. */
+  void undo(size_t mark);
+  /**
+   * Unit propagation of the assignments on the trail that were not
+   * propagated yet, with two watched literals per clause. False on a
+   * conflict.
+   */
+  bool propagate();
+  /** The clauses of the given ones that are not satisfied yet. */
+  void residual(const std::vector<uint32_t>& clauses,
+                std::vector<uint32_t>& rest) const;
+  /** Split clauses into sets that share no unassigned variable. */
+  void components(const std::vector<uint32_t>& clauses,
+                  std::vector<std::vector<uint32_t>>& comps);
+  /**
+   * The number of projected variables among vars that are unassigned and do
+   * not occur in the clauses, each of which doubles the count.
+   */
+  uint32_t numFree(const std::vector<uint32_t>& vars,
+                   const std::vector<uint32_t>& clauses);
+  /**
+   * Count the models of the clauses under the given assumptions, which are
+   * assigned before the search and not added to the clauses.
+   */
+  void count(const std::vector<SatLiteral>& assumptions);
+  /** The count of the product of the components of clauses. */
+  Integer countResidual(const std::vector<uint32_t>& clauses,
+                        const std::vector<uint32_t>& vars);
+  /**
+   * The number of assignments to the projected variables of a component
+   * that extend to a model of it. A component without projected variables
+   * counts 1 if it is satisfiable and 0 otherwise.
+   *
+   * countComponent() and countResidual() recurse once per decision, so the
+   * depth of the recursion is the number of decisions on a branch, which is
+   * at most the number of variables. It is limited to s_maxDepth so that a
+   * large instance fails with an exception instead of overflowing the stack.
+   */
+  Integer countComponent(const std::vector<uint32_t>& clauses);
+
+  /** The maximal number of nested decisions of the search. */
+  static constexpr uint32_t s_maxDepth = 10000;
+  /** The current number of nested decisions. */
+  uint32_t d_depth;
+
+  /**
+   * The clauses, with literals v + 1 or -(v + 1) for variable v. The first
+   * two literals of a clause with more than one literal are watched.
+   */
+  std::vector<std::vector<int>> d_clauses;
+  /** The clauses watching each literal, by the index 2 v (+ 1 if negative). */
+  std::vector<std::vector<uint32_t>> d_watches;
+  /** Current assignment of each variable: 1, -1 or 0 (unassigned). */
+  std::vector<int8_t> d_assign;
+  /** The assigned literals, in order, and the first one not propagated. */
+  std::vector<int> d_trail;
+  size_t d_qhead;
+  /** Union-find parents, used by components(). */
+  std::vector<uint32_t> d_parent;
+  /** Whether each variable is in the sampling set. */
+  std::vector<bool> d_projected;
+  /**
+   * Counts of components, keyed by their clause ids and their unassigned
+   * variables, followed by the number of clause ids.
+   */
+  std::unordered_map<std::vector<uint32_t>, Integer, KeyHash> d_cache;
+
+  /** The variables the count is projected on, all variables if empty. */
+  std::vector<SatVariable> d_samplingSet;
+
+  /** The count of the last call to solve(), if d_hasCount. */
+  Integer d_count;
+  bool d_hasCount;
+
+  SatVariable d_true;
+  SatVariable d_false;
+
+  class Statistics
+  {
+   public:
+    IntStat d_statCallsToSolve;
+    IntStat d_clausesAdded;
+    IntStat d_components;
+    IntStat d_cacheHits;
+    TimerStat d_solveTime;
+    Statistics(StatisticsRegistry& registry, const std::string& prefix);
+  };
+
+  unsigned d_numVariables;
+  bool d_okay;
+  Statistics d_statistics;
+};
+
+}  // namespace prop
+}  // namespace cvc5::internal
+
+#endif  // CVC5__PROP__EXACT_COUNTER_H
@@ -550,6 +550,27 @@ Node PropEngine::ensureLiteral(TNode n)
   return preprocessed;
 }
 
+void PropEngine::assertClause(const std::vector<Node>& lits)
+{
+  Assert(!d_inCheckSat) << "Sat solver in solve()!";
+  Assert(!isProofEnabled());
+  SatClause clause;
+  for (const Node& lit : lits)
+  {
+    bool negated = lit.getKind() == kind::NOT;
+    TNode atom = negated ? lit[0] : lit;
+    d_cnfStream->ensureLiteral(atom);
+    SatLiteral satLit = d_cnfStream->getLiteral(atom);
+    clause.push_back(negated ? ~satLit : satLit);
+  }
+  Trace("prop") << "assertClause(" << lits << ")" << std::endl;
+  // The clause is not a consequence of the assertions, so the decision
+  // engine must justify it like any other assertion.
+  d_theoryProxy->notifyAssertion(
+      NodeManager::currentNM()->mkOr(lits), TNode::null(), true);
+  d_satSolver->addClause(clause, false);
+}
+
 Node PropEngine::getPreprocessedTerm(TNode n)
 {
   // must preprocess
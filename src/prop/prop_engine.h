@@ -211,6 +211,15 @@ class PropEngine : protected EnvObj
    * via getSatValue().
    */
   Node ensureLiteral(TNode n);
+  /**
+   * Add the clause (or lits) directly to the SAT solver, bypassing
+   * preprocessing and CNF conversion. Each literal must be a (possibly
+   * negated) preprocessed atom, which is given a SAT literal if it does not
+   * have one yet. The clause is also notified to the decision engine, and is
+   * removed when the current user context is popped. This is used to block
+   * solutions while counting.
+   */
+  void assertClause(const std::vector<Node>& lits);
   /**
    * This returns the theory-preprocessed form of term n. This rewrites and
    * preprocesses n, which notice may involve adding clauses to the SAT solver
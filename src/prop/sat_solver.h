@@ -26,6 +26,7 @@
 #include "proof/clause_id.h"
 #include "proof/proof_node_manager.h"
 #include "prop/sat_solver_types.h"
+#include "util/integer.h"
 #include "util/statistics_stats.h"
 
 namespace cvc5::internal {
@@ -86,6 +87,20 @@ public:
    */
   virtual bool setPropagateOnly() { return false; }
 
+  /**
+   * Tell a model counting back end to count the projections of the models
+   * on the given variables only (the sampling set). Ignored by SAT solvers.
+   */
+  virtual void setSamplingSet(const std::vector<SatVariable>& vars) {}
+
+  /**
+   * Get the model count computed by the last solve() of a model counting
+   * back end.
+   *
+   * @return false if the solver is not a model counter or did not count yet.
+   */
+  virtual bool getModelCount(Integer& count) const { return false; }
+
   /** Interrupt the solver */
   virtual void interrupt() = 0;
 
@@ -17,7 +17,9 @@
 
 #include "prop/approxmc.h"
 #include "prop/cadical.h"
+#include "prop/cnf_dumper.h"
 #include "prop/cryptominisat.h"
+#include "prop/exact_counter.h"
 #include "prop/kissat.h"
 #include "prop/minisat/minisat.h"
 
@@ -65,6 +67,23 @@ SatSolver* SatSolverFactory::createApproxmc(StatisticsRegistry& registry,
 #endif
 }
 
+SatSolver* SatSolverFactory::createExactCounter(StatisticsRegistry& registry,
+                                                const std::string& name)
+{
+  ExactCounter* res = new ExactCounter(registry, name);
+  res->init();
+  return res;
+}
+
+SatSolver* SatSolverFactory::createCnfDumper(StatisticsRegistry& registry,
+                                             const std::string& filename,
+                                             const std::string& name)
+{
+  CnfDumper* res = new CnfDumper(registry, filename, name);
+  res->init();
+  return res;
+}
+
 SatSolver* SatSolverFactory::createCadical(StatisticsRegistry& registry,
                                            ResourceManager* resmgr,
                                            const std::string& name)
@@ -43,6 +43,13 @@ class SatSolverFactory
                                    ResourceManager* resmgr,
                                    const std::string& name = "");
 
+  static SatSolver* createExactCounter(StatisticsRegistry& registry,
+                                       const std::string& name = "");
+
+  static SatSolver* createCnfDumper(StatisticsRegistry& registry,
+                                    const std::string& filename,
+                                    const std::string& name = "");
+
   static SatSolver* createCadical(StatisticsRegistry& registry,
                                   ResourceManager* resmgr,
                                   const std::string& name = "");
@@ -72,15 +72,36 @@ void SetDefaults::setDefaultsPre(Options& opts)
   if (opts.counting.enumerateCount || opts.counting.smtapproxMC)
   {
     opts.writeBase().incrementalSolving = true;
+    // Counting only needs the model values of the projection variables to
+    // block a solution, checking every model is a debugging aid.
     opts.writeSmt().produceModels = true;
-    opts.writeSmt().checkModels = true;
-    opts.writeDriver().dumpModels = true;
-
+    if (opts.counting.countCheckModels)
+    {
+      opts.writeSmt().checkModels = true;
+    }
   }
   if (opts.counting.bitblastApproxMC)
   {
+    // In lazy mode the counter would only see the bit-vector facts of one
+    // propositional model, so the whole formula is bit-blasted eagerly.
     opts.writeBv().bvSatSolver = options::SatSolverMode::APPROXMC;
-    opts.writeBv().bitblastMode = options::BitblastMode::LAZY;
+    opts.writeBv().bitblastMode = options::BitblastMode::EAGER;
+  }
+  if (opts.counting.bitblastExactMC)
+  {
+    // As for --blast-apxmc, the whole formula is bit-blasted eagerly.
+    opts.writeBv().bvSatSolver = options::SatSolverMode::EXACTMC;
+    opts.writeBv().bitblastMode = options::BitblastMode::EAGER;
+  }
+  if (!opts.counting.dumpCountingCnf.empty())
+  {
+    // As for --blast-exactmc, the CNF of the whole formula is dumped.
+    opts.writeBv().bvSatSolver = options::SatSolverMode::DUMP;
+    opts.writeBv().bitblastMode = options::BitblastMode::EAGER;
+  }
+  else if (opts.bv.bvSatSolver == options::SatSolverMode::DUMP)
+  {
+    throw OptionException("--bv-sat-solver=dump requires --dump-counting-cnf");
   }
   if (opts.smt.checkModels || opts.driver.dumpModels)
   {
@@ -264,6 +285,23 @@ void SetDefaults::finalizeLogic(LogicInfo& logic, Options& opts) const
     }
   }
 
+  if (opts.counting.smtapproxMC
+      && opts.counting.hashsm == options::HashingMode::FF)
+  {
+    // the hashes of SMTApproxMC are equations over a finite field
+    logic = logic.getUnlockedCopy();
+    logic.enableTheory(THEORY_FF);
+    logic.lock();
+  }
+
+  if (opts.counting.smtapproxMC && logic.isTheoryEnabled(THEORY_FP))
+  {
+    // SMTApproxMC counts floating-point variables over their IEEE bits
+    logic = logic.getUnlockedCopy();
+    logic.enableTheory(THEORY_BV);
+    logic.lock();
+  }
+
   if (opts.smt.solveIntAsBV > 0)
   {
     // Int to BV currently always eliminates arithmetic completely (or otherwise
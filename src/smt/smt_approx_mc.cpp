@@ -19,69 +19,224 @@
 #include <cvc5/cvc5_export.h>
 #include <math.h>
 
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <fstream>
+#include <functional>
+#include <iomanip>
+#include <iterator>
+#include <limits>
+#include <sstream>
+#include <unordered_map>
+#include <unordered_set>
+
+#include "base/exception.h"
 #include "expr/node.h"
 #include "expr/node_converter.h"
+#include "expr/node_manager.h"
+#include "options/base_options.h"
 #include "options/counting_options.h"
+#include "options/main_options.h"
+#include "options/option_exception.h"
 #include "smt/smt_approx_mc.h"
 #include "solver_engine.h"
+#include "theory/arith/bound_inference.h"
+#include "util/bitvector.h"
+#include "util/integer.h"
 #include "util/random.h"
+#include "util/rational.h"
+
+#if HAVE_SYS_WAIT_H
+#include <signal.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#endif
 
 using std::vector;
 
 namespace cvc5::internal {
 namespace counting {
 
-void SmtApproxMc::populatePrimes()
-{
-  // TODO better way to do this
-  primes.push_back(2);           // 0
-  primes.push_back(2);           // 1
-  primes.push_back(5);           // 2
-  primes.push_back(11);          // 3
-  primes.push_back(17);          // 4
-  primes.push_back(37);          // 5
-  primes.push_back(67);          // 6
-  primes.push_back(131);         // 7
-  primes.push_back(257);         // 8
-  primes.push_back(521);         // 9
-  primes.push_back(1031);        // 10
-  primes.push_back(2053);        // 11
-  primes.push_back(4099);        // 12
-  primes.push_back(8209);        // 13
-  primes.push_back(16411);       // 14
-  primes.push_back(32771);       // 15
-  primes.push_back(65537);       // 16
-  primes.push_back(131101);      // 17
-  primes.push_back(262147);      // 18
-  primes.push_back(524309);      // 19
-  primes.push_back(1048583);     // 20
-  primes.push_back(2097169);     // 21
-  primes.push_back(4194319);     // 22
-  primes.push_back(8388617);     // 23
-  primes.push_back(16777259);    // 24
-  primes.push_back(33554467);    // 25
-  primes.push_back(67108879);    // 26
-  primes.push_back(134217757);   // 27
-  primes.push_back(268435459);   // 28
-  primes.push_back(536870923);   // 29
-  primes.push_back(1073741827);  // 30
-  primes.push_back(2147483659);  // 31
-  primes.push_back(4294967311);  // 32
-  primes.push_back(8589934609);  // 33
+namespace {
+
+/** Returns a^e mod m. */
+Integer modPow(const Integer& a, const Integer& e, const Integer& m)
+{
+  Integer res(1);
+  for (size_t i = e.length(); i > 0; --i)
+  {
+    res = res.modMultiply(res, m);
+    if (e.isBitSet(i - 1)) res = res.modMultiply(a, m);
+  }
+  return res;
+}
+
+/**
+ * Miller-Rabin test with the first 13 primes as bases, which is
+ * deterministic for n < 3.3 * 10^24 (about 81 bits). Beyond that the same
+ * fixed bases are used, so the result is still reproducible.
+ */
+bool isPrime(const Integer& n)
+{
+  static const uint32_t bases[] = {
+      2, 3, 5, 7, 11, 13, 17, 19, 23, 29, 31, 37, 41};
+  if (n < Integer(2)) return false;
+  for (uint32_t b : bases)
+  {
+    if (n == Integer(b)) return true;
+    if (n.floorDivideRemainder(Integer(b)).isZero()) return false;
+  }
+  // n - 1 = d * 2^r with d odd
+  Integer nm1 = n - Integer(1);
+  uint32_t r = 0;
+  while (!nm1.isBitSet(r)) ++r;
+  Integer d = nm1.divByPow2(r);
+  for (uint32_t b : bases)
+  {
+    Integer x = modPow(Integer(b), d, n);
+    if (x.isOne() || x == nm1) continue;
+    bool composite = true;
+    for (uint32_t i = 1; i < r && composite; ++i)
+    {
+      x = x.modMultiply(x, n);
+      composite = (x != nm1);
+    }
+    if (composite) return false;
+  }
+  return true;
+}
+
+/** Picks a uniformly random integer in [0, bound). */
+Integer pickInteger(Random& rng, const Integer& bound)
+{
+  // 32 extra random bits make the bias of the reduction negligible
+  uint32_t bits = bound.length() + 32;
+  Integer r;
+  for (uint32_t i = 0; i < bits; i += 32)
+  {
+    r = r.multiplyByPow2(32) + Integer(rng.pick(0, 0xffffffff));
+  }
+  return r.floorDivideRemainder(bound);
+}
+
+/**
+ * The seed of hash i of a round with the given seed (splitmix64 of both),
+ * so that nearby seeds and indices give unrelated generators.
+ */
+uint64_t getHashSeed(uint64_t seed, uint64_t i)
+{
+  uint64_t z = seed + (i + 1) * 0x9e3779b97f4a7c15ull;
+  z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ull;
+  z = (z ^ (z >> 27)) * 0x94d049bb133111ebull;
+  return z ^ (z >> 31);
+}
+
+}  // namespace
+
+/**
+ * The smallest prime >= 2^bits, the modulus of hashes over slices of the
+ * given size.
+ */
+const Integer& SmtApproxMc::getPrime(uint32_t bits)
+{
+  auto it = primes.find(bits);
+  if (it != primes.end()) return it->second;
+  Integer p = Integer(1).multiplyByPow2(bits);
+  while (!isPrime(p)) p += Integer(1);
+  return primes[bits] = p;
+}
+
+Term SmtApproxMc::mkBvConst(uint32_t width, const Integer& value)
+{
+  return d_slv->getSolver()->mkBitVector(width, value.toString(), 10);
 }
 
+/**
+ * Number of solutions a cell may contain before it is considered too big,
+ * as in ApproxMC4: 1 + 9.84 * (1 + eps / (1 + eps)) * (1 + 1 / eps)^2.
+ */
 uint32_t SmtApproxMc::getPivot()
 {
-  double epsilon = 0.8;
   uint32_t pivot;
-  pivot = int(2 * ceil(4.49 * pow((1 + 1 / epsilon), 2)));
+  pivot = uint32_t(1
+                   + 9.84 * (1 + (epsilon / (1.0 + epsilon)))
+                         * pow(1.0 + (1.0 / epsilon), 2.0));
   return pivot;
 }
 
+/**
+ * Probability that the median of t rounds is within the tolerance. Each
+ * round is within the tolerance with probability at least 1 - 0.36, and the
+ * median (the upper one for even t) is if at most (t - 1) / 2 rounds fail
+ * (binomial tail, as in ApproxMC4).
+ */
+double SmtApproxMc::getConfidence(uint32_t t)
+{
+  const double round_fail = 0.36;
+  if (t == 0) return 0;
+  double confidence = 0;
+  double term = pow(1 - round_fail, t);  // P[no round fails]
+  for (uint32_t k = 0; k <= (t - 1) / 2; ++k)
+  {
+    confidence += term;
+    term *= (double(t - k) / double(k + 1)) * (round_fail / (1 - round_fail));
+  }
+  return confidence;
+}
+
+/**
+ * Number of rounds whose median gives the count with probability at least
+ * 1 - delta: the smallest odd t with getConfidence(t) >= 1 - delta. Falls
+ * back to the Chernoff bound 17 * log2(3 / delta) if no such t <= 511 exists.
+ */
 uint32_t SmtApproxMc::getNumIter()
 {
-  double delta = 2.5;
-  return int(ceil(25 * log(3 / delta)));
+  for (uint32_t t = 1; t < 512; t += 2)
+  {
+    if (getConfidence(t) >= 1 - delta) return t;
+  }
+  return uint32_t(ceil(17 * log2(3 / delta)));
+}
+
+/**
+ * Whether counting stopped, which it does once the time of --count-budget
+ * is used up. Rounds that did not finish by then are dropped, and the count
+ * is the median of the finished ones.
+ */
+bool SmtApproxMc::countStopped()
+{
+  if (has_deadline && std::chrono::steady_clock::now() >= count_deadline)
+  {
+    stopCount("--count-budget");
+  }
+  return count_stopped;
+}
+
+/** Stops counting for the given reason, unless it already stopped. */
+void SmtApproxMc::stopCount(const std::string& reason)
+{
+  if (count_stopped) return;
+  count_stopped = true;
+  stop_reason = reason;
+  std::cout << "c [smtappmc] [ " << getTime() << "] counting stopped by "
+            << reason << std::endl;
+}
+
+/**
+ * Reports the median of the rounds finished so far, with the tolerance and
+ * the probability of failure it is known to have, so that a run stopped
+ * early still leaves a usable estimate in the log.
+ */
+void SmtApproxMc::reportEstimate(vector<Integer>& numList, bool exact)
+{
+  double achieved = exact ? 0 : 1 - getConfidence(numList.size());
+  std::cout << "c [smtappmc] [ " << getTime() << "] estimate after "
+            << numList.size() << " rounds: " << findMedian(numList)
+            << " epsilon: " << (exact ? 0 : epsilon)
+            << " delta: " << achieved << std::endl;
 }
 
 /**
@@ -93,6 +248,17 @@ SmtApproxMc::SmtApproxMc(SolverEngine* slv)
 {
   this->d_slv = slv;
   std::vector<Node> tlAsserts = slv->getAssertions();
+  // FNV-1a over the printed assertions, so that a checkpoint is only resumed
+  // on the same input
+  assertions_hash = 14695981039346656037ull;
+  for (const Node& a : tlAsserts)
+  {
+    for (char ch : a.toString() + "\n")
+    {
+      assertions_hash ^= static_cast<unsigned char>(ch);
+      assertions_hash *= 1099511628211ull;
+    }
+  }
 
   projection_prefix = slv->getOptions().counting.projprefix;
   get_projected_count = slv->getOptions().counting.projcount;
@@ -108,6 +274,7 @@ SmtApproxMc::SmtApproxMc(SolverEngine* slv)
   vars_in_formula = slv->getSolver()->getVars(bvnode_in_formula_v);
 
   vector<std::string> var_list;
+  std::vector<Term> ints, floats;
   for (Term n : vars_in_formula)
   {
     bool in_projset =
@@ -145,6 +312,7 @@ SmtApproxMc::SmtApproxMc(SolverEngine* slv)
     else if (n.getSort().isFloatingPoint())
     {
       num_floats++;
+      if (in_projset || !get_projected_count) floats.push_back(n);
     }
     else if (n.getSort().isReal())
     {
@@ -153,26 +321,27 @@ SmtApproxMc::SmtApproxMc(SolverEngine* slv)
     else if (n.getSort().isInteger())
     {
       num_integer++;
+      if (in_projset || !get_projected_count) ints.push_back(n);
     }
   }
-
-  if (num_bv_projset == 0 && num_bool_projset > 0)
-    project_on_booleans = true;
-  else
-    project_on_booleans = false;
-
-  projection_var_terms = bvs_in_projset;
-  projection_var_terms.insert(projection_var_terms.end(),
-                              booleans_in_projset.begin(),
-                              booleans_in_projset.end());
-
-  projection_vars = slv->getSolver()->termVectorToNodes1(projection_var_terms);
+  if (!floats.empty()) addFloatingPointBits(floats);
+  if (!ints.empty()) inferIntegerBounds(tlAsserts, ints);
+  if (slv->getOptions().counting.indepSupport) minimizeSupport(tlAsserts);
+  if (slv->getOptions().counting.countComponents) findComponents(tlAsserts);
+  applyProjection();
 
   slice_size = slv->getOptions().counting.slicesize;
   if (slice_size == 0) slice_size = max_bitwidth / 2;
   if (slice_size > max_bitwidth) slice_size = max_bitwidth;
-  if (slice_size > 32) slice_size = 16;
+  if (slice_size == 0) slice_size = 1;
   verb = slv->getOptions().counting.countingverb;
+  epsilon = slv->getOptions().counting.epsilon;
+  delta = slv->getOptions().counting.delta;
+  if (epsilon <= 0 || delta <= 0 || delta >= 1)
+  {
+    throw OptionException(
+        "SMTApproxMC needs --epsilon > 0 and 0 < --delta < 1");
+  }
 
   std::cout << "c [smtappmc] formula spec: Booleans: " << num_bool
             << " bitvectors: " << num_bv << " max width = " << max_bitwidth
@@ -180,299 +349,2036 @@ SmtApproxMc::SmtApproxMc(SolverEngine* slv)
             << "c [smtappmc] Reals: " << num_real << " FPs: " << num_floats
             << " Integers: " << num_integer << std::endl
             << "c [smtappmc] Sampling set: Booleans: " << num_bool_projset
-            << " bitvectors: " << num_bv_projset << std::endl;
+            << " bitvectors: " << num_bv_projset
+            << " Integers: " << ints_in_projset.size() << std::endl
+            << "c [smtappmc] epsilon: " << epsilon << " delta: " << delta
+            << " pivot: " << getPivot() << " rounds: " << getNumIter()
+            << std::endl;
+
+  buildSliceTable();
 }
 
-Term SmtApproxMc::generate_boolean_hash()
+/**
+ * Counts each floating-point projection variable x through a bit-vector
+ * x_ieee of its IEEE encoding, with x = to_fp(x_ieee). All NaN encodings
+ * denote the same value, so x_ieee is fixed to the canonical quiet NaN when
+ * x is NaN; x_ieee is then a function of x and is hashed and blocked like
+ * any other projection bit-vector.
+ */
+void SmtApproxMc::addFloatingPointBits(const std::vector<Term>& floats)
 {
   cvc5::Solver* solver = d_slv->getSolver();
-  Term xorcons = solver->mkBoolean(Random::getRandom().pick(0, 1));
-  for (cvc5::Term x : booleans_in_projset)
+  for (const Term& x : floats)
   {
-    Assert(x.getSort().isBoolean());
-    if (Random::getRandom().pick(0, 1) == 1)
-    {
-      xorcons = solver->mkTerm(XOR, {xorcons, x});
-    }
+    uint32_t eb = x.getSort().getFloatingPointExponentSize();
+    uint32_t sb = x.getSort().getFloatingPointSignificandSize();
+    Term bits = solver->mkConst(solver->mkBitVectorSort(eb + sb),
+                                x.getSymbol() + "_ieee");
+    Op to_fp = solver->mkOp(FLOATINGPOINT_TO_FP_FROM_IEEE_BV, {eb, sb});
+    solver->assertFormula(
+        solver->mkTerm(EQUAL, {x, solver->mkTerm(to_fp, {bits})}));
+    Term nan = solver->mkBitVector(
+        eb + sb, "0" + std::string(eb + 1, '1') + std::string(sb - 2, '0'), 2);
+    solver->assertFormula(
+        solver->mkTerm(IMPLIES,
+                       {solver->mkTerm(FLOATINGPOINT_IS_NAN, {x}),
+                        solver->mkTerm(EQUAL, {bits, nan})}));
+    bvs_in_projset.push_back(bits);
+    fp_links.emplace_back(x, bits);
+    num_bv_projset++;
+    max_bitwidth = std::max(max_bitwidth, eb + sb);
   }
-  return xorcons;
 }
 
-uint64_t SmtApproxMc::getMinBW()
+/**
+ * Derives the projection terms and nodes from the projection sets, and the
+ * kind of hash from their variables: XORs over the Booleans if there are
+ * only Booleans, linear integer hashes if there are Integers, and --hashsm
+ * otherwise.
+ */
+void SmtApproxMc::applyProjection()
 {
-  uint32_t min_bw = 2 * slice_size + 1;
-  uint32_t num_sliced_var = 0;
-  for (cvc5::Term x : bvs_in_projset)
+  num_bv_projset = bvs_in_projset.size();
+  num_bool_projset = booleans_in_projset.size();
+  project_on_booleans = num_bv_projset == 0 && ints_in_projset.empty()
+                        && num_bool_projset > 0;
+
+  options::HashingMode hashsm = d_slv->getOptions().counting.hashsm;
+  lia_hashing = !ints_in_projset.empty();
+  bit_hashing = !project_on_booleans && !lia_hashing
+                && hashsm == options::HashingMode::XOR;
+  ff_hashing = !project_on_booleans && !lia_hashing
+               && hashsm == options::HashingMode::FF;
+  if (lia_hashing
+      && (hashsm == options::HashingMode::XOR
+          || hashsm == options::HashingMode::FF))
   {
-    uint32_t this_bv_width = x.getSort().getBitVectorSize();
-    uint32_t num_slices = (this_bv_width + slice_size - 1) / slice_size;
-    num_sliced_var += num_slices;
+    std::cout << "c [smtappmc] Integers in the sampling set, using linear "
+                 "integer hashes instead of --hashsm"
+              << std::endl;
   }
-  uint32_t extension_for_sum =
-      static_cast<uint32_t>(std::ceil(std::log(num_sliced_var) / std::log(2)));
-
-  min_bw += extension_for_sum;
-  // std::cout << "extending " << slice_size << " bits to " << slice_size +
-  // min_bw << std::endl;
-
-  return min_bw;
-}
-
-Term SmtApproxMc::generate_integer_hash(uint32_t hash_num)
-{
-  cvc5::Solver* solver = d_slv->getSolver();
-  uint32_t new_bv_width = getMinBW();
-
-  Term p = solver->mkBitVector(new_bv_width, primes[slice_size]);
-
-  uint32_t c_i = Random::getRandom().pick(0, primes[slice_size] - 1);
 
-  Term axpb = solver->mkBitVector(new_bv_width, 0);
-  Term one = solver->mkBitVector(new_bv_width, 1);
-  Term maxx = solver->mkBitVector(new_bv_width, pow(2, slice_size + 1));
-  Term c = solver->mkBitVector(new_bv_width, c_i);
-
-  Sort bvsort = solver->mkBitVectorSort(new_bv_width);
-  std::string var_name = "hash" + std::to_string(hash_num);
-  Term new_var = solver->mkConst(bvsort, var_name);
-  projection_var_terms.push_back(new_var);
+  projection_var_terms = bvs_in_projset;
+  projection_var_terms.insert(projection_var_terms.end(),
+                              booleans_in_projset.begin(),
+                              booleans_in_projset.end());
+  for (const BoundedInt& x : ints_in_projset)
+  {
+    projection_var_terms.push_back(x.var);
+  }
   projection_vars =
       d_slv->getSolver()->termVectorToNodes1(projection_var_terms);
-  Term new_var_mult_p = solver->mkTerm(BITVECTOR_MULT, {new_var, p});
-  Term new_var_plusone = solver->mkTerm(BITVECTOR_ADD, {new_var, one});
-  Term new_var_plusone_mult_p =
-      solver->mkTerm(BITVECTOR_MULT, {new_var_plusone, p});
-  Term hash_const_less = solver->mkTerm(BITVECTOR_ULT, {new_var, maxx});
-  c = solver->mkTerm(BITVECTOR_ADD, {c, new_var_mult_p});
-
-  Trace("smap-hash") << pow(2, slice_size) << "Adding Hash: (";
+}
 
-  for (cvc5::Term x : bvs_in_projset)
+/**
+ * Splits the projection variables into groups whose top-level conjuncts
+ * share no symbol, with union-find over the symbols of the conjuncts. The
+ * projected count is then the product of the counts of the groups, each
+ * projected on its own variables.
+ */
+void SmtApproxMc::findComponents(const std::vector<Node>& assertions)
+{
+  std::unordered_map<Node, Node> parent;
+  std::function<Node(const Node&)> find = [&](const Node& n) {
+    auto it = parent.find(n);
+    if (it == parent.end() || it->second == n) return n;
+    Node root = find(it->second);
+    parent[n] = root;
+    return root;
+  };
+  auto join = [&](const Node& a, const Node& b) {
+    Node ra = find(a), rb = find(b);
+    if (ra != rb) parent[rb] = ra;
+  };
+
+  std::vector<Node> visit(assertions.begin(), assertions.end());
+  while (!visit.empty())
   {
-    uint32_t this_bv_width = x.getSort().getBitVectorSize();
-    uint32_t num_slices = ceil(this_bv_width / slice_size);
-    if (slice_size > this_bv_width) num_slices = 1;
-    for (uint32_t slice = 0; slice < num_slices; ++slice)
+    Node lit = visit.back();
+    visit.pop_back();
+    if (lit.getKind() == kind::AND)
     {
-      uint32_t this_slice_start = slice * slice_size;
-      uint32_t this_slice_end = (slice + 1) * slice_size - 1;
-      uint extend_x_by_bits = 2 + slice_size;
-      if (this_slice_end >= this_bv_width)
-      {
-        extend_x_by_bits = this_slice_end - this_bv_width + 3 + slice_size;
-        this_slice_end = this_bv_width - 1;
-      }
-      uint32_t a_i = Random::getRandom().pick(0, primes[slice_size] - 1);
-      Trace("smap-hash") << a_i << x.getSymbol() << "[" << this_slice_start
-                         << ":" << this_slice_end << "] + ";
-
-      Op x_bit_op =
-          solver->mkOp(BITVECTOR_EXTRACT, {this_slice_end, this_slice_start});
-      Term x_sliced = solver->mkTerm(x_bit_op, {x});
-      Op x_zero_ex_op = solver->mkOp(BITVECTOR_ZERO_EXTEND, {extend_x_by_bits});
-      x_sliced = solver->mkTerm(x_zero_ex_op, {x_sliced});
-      Term a = solver->mkBitVector(new_bv_width, a_i);
-      Term ax = solver->mkTerm(BITVECTOR_MULT, {a, x_sliced});
-      axpb = solver->mkTerm(BITVECTOR_ADD, {ax, axpb});
+      visit.insert(visit.end(), lit.begin(), lit.end());
+      continue;
+    }
+    std::unordered_set<Node> syms;
+    expr::getSymbols(lit, syms);
+    for (const Node& s : syms)
+    {
+      join(*syms.begin(), s);
     }
   }
+  cvc5::Solver* solver = d_slv->getSolver();
+  for (const std::pair<Term, Term>& link : fp_links)
+  {
+    std::vector<Node> nodes =
+        solver->termVectorToNodes1({link.first, link.second});
+    join(nodes[0], nodes[1]);
+  }
 
-  Trace("smap-hash") << " 0) = " << primes[slice_size] << "h" << hash_num
-                     << " + " << c_i << "\n";
-
-  Term hash_const = solver->mkTerm(EQUAL, {axpb, c});
-  //   hash_const_less =
-  //     solver->mkTerm(BITVECTOR_ULE, {c,maxx});
-  Trace("smap-print-hash") << "\n"
-                           << "(assert " << hash_const << ")"
-                           << "\n";
-  hash_const = solver->mkTerm(AND, {hash_const, hash_const_less});
-  Trace("smap-print-hash") << "\n"
-                           << "(assert " << hash_const_less << ")"
-                           << "\n";
-  Trace("smap-print-hash") << "\n"
-                           << "(assert " << hash_const << ")"
-                           << "\n";
-
-  return hash_const;
+  std::unordered_map<Node, size_t> group_of;
+  auto group = [&](const Term& t) {
+    Node root = find(solver->termVectorToNodes1({t})[0]);
+    auto it = group_of.find(root);
+    if (it == group_of.end())
+    {
+      it = group_of.emplace(root, components.size()).first;
+      components.emplace_back();
+    }
+    return &components[it->second];
+  };
+  for (const Term& x : bvs_in_projset)
+  {
+    group(x)->bvs.push_back(x);
+  }
+  for (const Term& x : booleans_in_projset)
+  {
+    group(x)->booleans.push_back(x);
+  }
+  for (const BoundedInt& x : ints_in_projset)
+  {
+    group(x.var)->ints.push_back(x);
+  }
+  if (components.size() < 2)
+  {
+    components.clear();
+    return;
+  }
+  std::cout << "c [smtappmc] " << components.size()
+            << " independent components in the sampling set" << std::endl;
 }
 
-Term SmtApproxMc::generate_hash()
+/**
+ * Drops the projection variables that are defined by a top-level equality
+ * v = t, where t only has projection variables that are kept. Every dropped
+ * variable is then a function of the kept ones, so the projected count is
+ * the same and the hashes range over fewer variables. A definition may not
+ * use a variable that was dropped before, which rules out cycles.
+ */
+void SmtApproxMc::minimizeSupport(const std::vector<Node>& assertions)
 {
-  cvc5::Solver* solver = d_slv->getSolver();
-
-  uint32_t new_bv_width = getMinBW();
-
-  Term p = solver->mkBitVector(new_bv_width, primes[slice_size]);
-
-  uint32_t c_i = Random::getRandom().pick(0, primes[slice_size] - 1);
-
-  Term axpb = solver->mkBitVector(new_bv_width, 0);
-  Term c = solver->mkBitVector(new_bv_width, c_i);
-
-  Trace("smap-hash") << "Adding a hash constraint (size "
-                     << bvs_in_formula.size() << ") : (";
+  std::vector<Term> vars = bvs_in_projset;
+  vars.insert(
+      vars.end(), booleans_in_projset.begin(), booleans_in_projset.end());
+  for (const BoundedInt& x : ints_in_projset)
+  {
+    vars.push_back(x.var);
+  }
+  std::vector<Node> var_nodes = d_slv->getSolver()->termVectorToNodes1(vars);
+  std::unordered_map<Node, size_t> index;
+  for (size_t i = 0, n = var_nodes.size(); i < n; ++i)
+  {
+    index[var_nodes[i]] = i;
+  }
 
-  for (cvc5::Term x : bvs_in_projset)
+  std::vector<bool> defined(vars.size(), false);
+  size_t num_defined = 0;
+  std::vector<Node> visit(assertions.rbegin(), assertions.rend());
+  while (!visit.empty())
   {
-    uint32_t this_bv_width = x.getSort().getBitVectorSize();
-    uint32_t num_slices = ceil(this_bv_width / slice_size);
-    if (slice_size > this_bv_width)
+    Node lit = visit.back();
+    visit.pop_back();
+    if (lit.getKind() == kind::AND)
     {
-      num_slices = 1;
+      for (size_t i = lit.getNumChildren(); i > 0; --i)
+      {
+        visit.push_back(lit[i - 1]);
+      }
+      continue;
     }
-    for (uint32_t slice = 0; slice < num_slices; ++slice)
+    if (lit.getKind() != kind::EQUAL) continue;
+    for (size_t side = 0; side < 2; ++side)
     {
-      uint32_t this_slice_start = slice * slice_size;
-      uint32_t this_slice_end = (slice + 1) * slice_size - 1;
-      uint32_t extend_x_by_bits = new_bv_width - slice_size;
-
-      // If slicesize does not divide bv width, and this is last
-      // slice, then extend this slice more than others
-      if (this_slice_end >= this_bv_width)
+      auto it = index.find(lit[side]);
+      if (it == index.end() || defined[it->second]) continue;
+      std::unordered_set<Node> syms;
+      expr::getSymbols(lit[1 - side], syms);
+      bool is_definition = std::all_of(
+          syms.begin(), syms.end(), [&](const Node& s) {
+            auto sit = index.find(s);
+            return sit != index.end() && sit != it && !defined[sit->second];
+          });
+      if (is_definition)
       {
-        extend_x_by_bits =
-            this_slice_end - this_bv_width + 1 + new_bv_width - slice_size;
-        this_slice_end = this_bv_width - 1;
+        Trace("smap") << "Defined projection variable: " << lit << "\n";
+        defined[it->second] = true;
+        num_defined++;
+        break;
       }
-
-      uint32_t a_i = Random::getRandom().pick(0, primes[slice_size] - 1);
-      Trace("smap-hash") << a_i << x.getSymbol() << "[" << this_slice_start
-                         << ":" << this_slice_end << "] + ";
-
-      Op x_bit_op =
-          solver->mkOp(BITVECTOR_EXTRACT, {this_slice_end, this_slice_start});
-      Term x_sliced = solver->mkTerm(x_bit_op, {x});
-      Op x_zero_ex_op = solver->mkOp(BITVECTOR_ZERO_EXTEND, {extend_x_by_bits});
-      x_sliced = solver->mkTerm(x_zero_ex_op, {x_sliced});
-      Term a = solver->mkBitVector(new_bv_width, a_i);
-      Term ax = solver->mkTerm(BITVECTOR_MULT, {a, x_sliced});
-      // ax = solver->mkTerm(BITVECTOR_UREM, {ax,p});
-      axpb = solver->mkTerm(BITVECTOR_ADD, {ax, axpb});
     }
   }
-
-  axpb = solver->mkTerm(BITVECTOR_UREM, {axpb, p});
-  Trace("smap-hash") << " 0) mod " << primes[slice_size] << " = " << c_i
-                     << "\n";
-
-  Term hash_const = solver->mkTerm(EQUAL, {axpb, c});
-  Trace("smap-print-hash") << "chash "
-                           << "(assert " << hash_const << ")"
-                           << "\n";
-
-  return hash_const;
+  if (num_defined == 0) return;
+
+  size_t next = 0;
+  auto keep = [&](const Term&) { return !defined[next++]; };
+  std::vector<Term> bvs, bools;
+  std::copy_if(bvs_in_projset.begin(),
+               bvs_in_projset.end(),
+               std::back_inserter(bvs),
+               keep);
+  std::copy_if(booleans_in_projset.begin(),
+               booleans_in_projset.end(),
+               std::back_inserter(bools),
+               keep);
+  std::vector<BoundedInt> ints;
+  for (const BoundedInt& x : ints_in_projset)
+  {
+    if (!defined[next++]) ints.push_back(x);
+  }
+  bvs_in_projset = bvs;
+  booleans_in_projset = bools;
+  ints_in_projset = ints;
+  num_bv_projset = bvs_in_projset.size();
+  num_bool_projset = booleans_in_projset.size();
+  std::cout << "c [smtappmc] independent support: " << num_defined << " of "
+            << vars.size()
+            << " projection variables are defined by the others" << std::endl;
 }
 
-uint64_t SmtApproxMc::smtApproxMcMain()
+/**
+ * Keeps the Integer projection variables with a lower and an upper bound
+ * among the top-level literals of the assertions. Without bounds a variable
+ * may have infinitely many values, which cannot be counted by hashing, so
+ * it must be left out of the projection with --projcount.
+ */
+void SmtApproxMc::inferIntegerBounds(const std::vector<Node>& assertions,
+                                     const std::vector<Term>& ints)
 {
-  uint32_t numIters;
-  numIters = getNumIter();
-  uint64_t countThisIter;
-
-  vector<uint64_t> numList;
-  populatePrimes();
+  theory::arith::BoundInference bounds(d_slv->getEnv());
+  std::vector<Node> visit(assertions.begin(), assertions.end());
+  while (!visit.empty())
+  {
+    Node lit = visit.back();
+    visit.pop_back();
+    if (lit.getKind() == kind::AND)
+    {
+      visit.insert(visit.end(), lit.begin(), lit.end());
+      continue;
+    }
+    Node atom = lit.getKind() == kind::NOT ? lit[0] : lit;
+    Kind k = atom.getKind();
+    if (k == kind::LEQ || k == kind::LT || k == kind::GEQ || k == kind::GT
+        || (k == kind::EQUAL && atom[0].getType().isRealOrInt()))
+    {
+      bounds.add(lit);
+    }
+  }
 
-  for (uint32_t iter = 1; iter <= numIters; ++iter)
+  std::vector<Node> int_nodes = d_slv->getSolver()->termVectorToNodes1(ints);
+  for (size_t i = 0, n = ints.size(); i < n; ++i)
   {
-    countThisIter = smtApproxMcCore();
-    if (countThisIter == 0 && numHashes > 0)
+    theory::arith::Bounds b = bounds.get(int_nodes[i]);
+    if (b.lower_value.isNull() || b.upper_value.isNull())
     {
-      std::cout << "c [smtappmc] [ " << getTime()
-                << "] completed round: " << iter << "] failing count "
-                << std::endl;
-      iter--;
+      throw OptionException("cannot infer bounds of the projection variable "
+                            + ints[i].getSymbol()
+                            + ", use --projcount to count without it");
     }
-    else
+    Integer lower = b.lower_value.getConst<Rational>().ceiling();
+    Integer upper = b.upper_value.getConst<Rational>().floor();
+    if (b.lower_strict) lower += 1;
+    if (b.upper_strict) upper -= 1;
+    if (upper < lower)
     {
-      std::cout << "c [smtappmc] [ " << getTime()
-                << "] completed round: " << iter << " count: " << countThisIter
-                << std::endl;
-      numList.push_back(countThisIter);
+      // The assertions have no model, whatever the other variables are
+      std::cout << "c [smtappmc] the bounds of Integer " << ints[i].getSymbol()
+                << " are empty" << std::endl;
+      empty_int_bounds = true;
+      continue;
     }
-    if (numHashes == 0) break;
+    // a fixed variable has a single value and does not change the count
+    if (upper == lower) continue;
+    uint32_t width = (upper - lower).length();
+    Trace("smap") << "Integer " << ints[i].getSymbol() << " in [" << lower
+                  << ", " << upper << "], " << width << " bits\n";
+    ints_in_projset.push_back({ints[i], lower, width});
+    max_bitwidth = std::max(max_bitwidth, width);
   }
-  countThisIter = findMedian(numList);
-  std::cout << "c Total time : " << getTime() << std::endl;
-  return countThisIter;
 }
 
-double SmtApproxMc::getTime()
+uint32_t SmtApproxMc::getNumSlices(uint32_t bv_width)
 {
-  std::stringstream s;
-  std::string time_str1;
-  s << d_slv->getSolver()->getStatistics().get("global::totalTime");
-  s >> time_str1;
-  time_str1.resize(time_str1.size() - 2);
-  const std::string time_str = time_str1;
-  double time_int = std::stod(time_str) / 1000.0;
-  return time_int;
+  return (bv_width + slice_size - 1) / slice_size;
 }
 
-vector<Node>& SmtApproxMc::get_projection_nodes() { return projection_vars; }
-
-uint64_t SmtApproxMc::smtApproxMcCore()
+uint32_t SmtApproxMc::getMaxHashes()
 {
-  Term hash;
-  int growingphase = 1;
-  int lowbound = 1, highbound = 2;
-  int nochange = 0;
-  oldhashes = 0;
-
-  int64_t bound = getPivot();
-  int64_t count = bound;
-  std::string ss = "";
+  // Each hash divides the solution space by at least 2 (Booleans) or by
+  // getPrime(slice_size) > 2^slice_size, so with one more hash than the
+  // number of projected bits (resp. slices) every cell is expected to
+  // contain less than one solution.
+  if (project_on_booleans)
+    return booleans_in_projset.size() + 1;
+  if (bit_hashing) return bit_terms.size() + booleans_in_projset.size() + 1;
+  return slice_table.size() + 1;
+}
 
-  while (true)
+SmtApproxMc::HashCoeffs SmtApproxMc::drawHash(uint32_t hash_num)
+{
+  Random rng(getHashSeed(hash_seed, hash_num));
+  HashCoeffs h;
+  if (project_on_booleans)
+  {
+    h.c = rng.pick(0, 1);
+    for (size_t i = 0, n = booleans_in_projset.size(); i < n; ++i)
+    {
+      h.a.push_back(rng.pick(0, 1));
+    }
+    return h;
+  }
+  if (bit_hashing)
+  {
+    h.c = rng.pick(0, 1);
+    size_t n = bit_terms.size() + booleans_in_projset.size();
+    for (size_t i = 0; i < n; ++i)
+    {
+      h.a.push_back(rng.pick(0, 1));
+    }
+    return h;
+  }
+  h.c = pickInteger(rng, getPrime(slice_size));
+  for (size_t i = 0, n = slice_table.size(); i < n; ++i)
+  {
+    h.a.push_back(pickInteger(rng, getPrime(slice_size)));
+  }
+  return h;
+}
+
+void SmtApproxMc::drawHashFamily(uint32_t num_hashes)
+{
+  while (hash_family.size() < num_hashes)
+  {
+    hash_family.push_back(drawHash(hash_family.size()));
+  }
+}
+
+Term SmtApproxMc::generate_boolean_hash(uint32_t hash_num)
+{
+  cvc5::Solver* solver = d_slv->getSolver();
+  const HashCoeffs& h = hash_family[hash_num];
+  Term xorcons = solver->mkBoolean(h.c.isOne());
+  for (size_t i = 0, n = booleans_in_projset.size(); i < n; ++i)
+  {
+    Assert(booleans_in_projset[i].getSort().isBoolean());
+    if (h.a[i].isOne())
+    {
+      xorcons = solver->mkTerm(XOR, {xorcons, booleans_in_projset[i]});
+    }
+  }
+  return xorcons;
+}
+
+/**
+ * Adds the parity hash h_i over the projection bits directly to the bit-level
+ * BV solver, and returns the literal that activates it. The XOR also ranges
+ * over a fresh activation bit, which absorbs the parity (so the hash is
+ * vacuous) unless the bit is assumed to be 0. The Boolean projection
+ * variables are not bit-blasted, their part of the parity enters the XOR
+ * through a 1-bit variable defined at the word level.
+ */
+Term SmtApproxMc::generate_xor_hash(uint32_t hash_num)
+{
+  cvc5::Solver* solver = d_slv->getSolver();
+  const HashCoeffs& h = hash_family[hash_num];
+  Sort bv1 = solver->mkBitVectorSort(1);
+  Term bv_zero = solver->mkBitVector(1u, 0u);
+  Term bv_one = solver->mkBitVector(1u, 1u);
+
+  std::vector<Term> bits;
+  for (size_t i = 0, n = bit_terms.size(); i < n; ++i)
+  {
+    if (h.a[i].isOne()) bits.push_back(bit_terms[i]);
+  }
+  Term bool_parity;
+  for (size_t i = 0, n = booleans_in_projset.size(); i < n; ++i)
+  {
+    if (h.a[bit_terms.size() + i].isZero()) continue;
+    bool_parity = bool_parity.isNull()
+                      ? booleans_in_projset[i]
+                      : solver->mkTerm(XOR, {bool_parity, booleans_in_projset[i]});
+  }
+  Term act = solver->mkConst(bv1, "hash_act" + std::to_string(hash_num));
+  Term sel = solver->mkTerm(EQUAL, {act, bv_zero});
+  if (!bool_parity.isNull())
+  {
+    // Defined under the selector only, so that preprocessing does not
+    // eliminate it by substitution after its bit went into the XOR.
+    Term par = solver->mkConst(bv1, "hash_par" + std::to_string(hash_num));
+    Term def = solver->mkTerm(
+        EQUAL, {solver->mkTerm(EQUAL, {par, bv_one}), bool_parity});
+    solver->assertFormula(solver->mkTerm(IMPLIES, {sel, def}));
+    bits.push_back(par);
+  }
+  bits.push_back(act);
+
+  Trace("smap-hash") << "Adding xor hash over " << bits.size()
+                     << " bits = " << h.c << "\n";
+  if (!d_slv->assertBitXor(solver->termVectorToNodes1(bits), h.c.isOne()))
+  {
+    throw Exception("--hashsm=xor needs the bit-blasting BV solver");
+  }
+  return sel;
+}
+
+/**
+ * Declares the field variables of the projection bits and links them to the
+ * bits. This is done once, at the base level, so that the links survive the
+ * pops of the rounds; the field variables are determined by the projection
+ * variables, so they do not change the count.
+ */
+void SmtApproxMc::buildFiniteFieldBits()
+{
+  cvc5::Solver* solver = d_slv->getSolver();
+  ff_sort = solver->mkFiniteFieldSort(getPrime(slice_size).toString());
+  Term ff_one = solver->mkFiniteFieldElem("1", ff_sort);
+  Term bv_one = solver->mkBitVector(1u, 1u);
+  uint32_t next_slice = 0;
+  for (cvc5::Term x : bvs_in_projset)
+  {
+    uint32_t this_bv_width = x.getSort().getBitVectorSize();
+    for (uint32_t bit = 0; bit < this_bv_width; ++bit)
+    {
+      Term b = solver->mkConst(
+          ff_sort, x.getSymbol() + "_ff" + std::to_string(bit));
+      Op x_bit_op = solver->mkOp(BITVECTOR_EXTRACT, {bit, bit});
+      Term x_bit = solver->mkTerm(x_bit_op, {x});
+      solver->assertFormula(
+          solver->mkTerm(EQUAL,
+                         {solver->mkTerm(EQUAL, {b, ff_one}),
+                          solver->mkTerm(EQUAL, {x_bit, bv_one})}));
+      solver->assertFormula(solver->mkTerm(
+          EQUAL, {solver->mkTerm(FINITE_FIELD_MULT, {b, b}), b}));
+      ff_bits.push_back(b);
+      ff_bit_slice.push_back(next_slice + bit / slice_size);
+      ff_bit_pos.push_back(bit % slice_size);
+    }
+    next_slice += getNumSlices(this_bv_width);
+  }
+}
+
+/**
+ * The hash sum_k a_k * slice_k = c over GF(p), with p = getPrime(slice_size).
+ * Each slice is expanded into its field bits, so the hash is a single linear
+ * equation sum_j (a_k * 2^pos_j mod p) * b_j = c that the finite field solver
+ * handles algebraically, with no bit-vector arithmetic to bit-blast.
+ */
+Term SmtApproxMc::generate_ff_hash(uint32_t hash_num)
+{
+  cvc5::Solver* solver = d_slv->getSolver();
+  const HashCoeffs& h = hash_family[hash_num];
+  const Integer& p = getPrime(slice_size);
+
+  std::vector<Term> summands;
+  for (size_t j = 0, n = ff_bits.size(); j < n; ++j)
+  {
+    Integer coeff = (h.a[ff_bit_slice[j]] * Integer(2).pow(ff_bit_pos[j]))
+                        .floorDivideRemainder(p);
+    if (coeff.isZero()) continue;
+    Term a = solver->mkFiniteFieldElem(coeff.toString(), ff_sort);
+    summands.push_back(solver->mkTerm(FINITE_FIELD_MULT, {a, ff_bits[j]}));
+  }
+  Term sum;
+  if (summands.empty())
+    sum = solver->mkFiniteFieldElem("0", ff_sort);
+  else if (summands.size() == 1)
+    sum = summands[0];
+  else
+    sum = solver->mkTerm(FINITE_FIELD_ADD, summands);
+  Term c = solver->mkFiniteFieldElem(h.c.toString(), ff_sort);
+  Term hash_const = solver->mkTerm(EQUAL, {sum, c});
+  Trace("smap-print-hash") << "ffhash "
+                           << "(assert " << hash_const << ")"
+                           << "\n";
+  return hash_const;
+}
+
+uint64_t SmtApproxMc::getMinBW()
+{
+  uint32_t min_bw = 2 * slice_size + 1;
+  uint32_t num_sliced_var = 0;
+  for (cvc5::Term x : bvs_in_projset)
+  {
+    num_sliced_var += getNumSlices(x.getSort().getBitVectorSize());
+  }
+  // The sum of num_sliced_var products needs ceil(log2(num_sliced_var)) more
+  // bits, none for a single slice.
+  uint32_t extension_for_sum = 0;
+  while ((uint64_t(1) << extension_for_sum) < num_sliced_var)
+  {
+    ++extension_for_sum;
+  }
+
+  min_bw += extension_for_sum;
+  // std::cout << "extending " << slice_size << " bits to " << slice_size +
+  // min_bw << std::endl;
+
+  return min_bw;
+}
+
+void SmtApproxMc::buildSliceTable()
+{
+  cvc5::Solver* solver = d_slv->getSolver();
+  slice_table.clear();
+  bit_terms.clear();
+  if (bit_hashing)
+  {
+    for (cvc5::Term x : bvs_in_projset)
+    {
+      for (uint32_t i = 0, w = x.getSort().getBitVectorSize(); i < w; ++i)
+      {
+        Op x_bit_op = solver->mkOp(BITVECTOR_EXTRACT, {i, i});
+        bit_terms.push_back(solver->mkTerm(x_bit_op, {x}));
+      }
+    }
+    return;
+  }
+  if (lia_hashing)
+  {
+    for (cvc5::Term x : bvs_in_projset)
+    {
+      uint32_t this_bv_width = x.getSort().getBitVectorSize();
+      for (uint32_t start = 0; start < this_bv_width; start += slice_size)
+      {
+        uint32_t end = std::min(start + slice_size, this_bv_width) - 1;
+        Op x_bit_op = solver->mkOp(BITVECTOR_EXTRACT, {end, start});
+        Term x_sliced = solver->mkTerm(
+            BITVECTOR_TO_NAT, {solver->mkTerm(x_bit_op, {x})});
+        slice_table.push_back({x_sliced,
+                               x.getSymbol() + "[" + std::to_string(start)
+                                   + ":" + std::to_string(end) + "]"});
+      }
+    }
+    // The value of x - lower, sliced with integer division and modulus
+    for (const BoundedInt& x : ints_in_projset)
+    {
+      Term y = x.var;
+      if (!x.lower.isZero())
+      {
+        y = solver->mkTerm(SUB, {y, solver->mkInteger(x.lower.toString())});
+      }
+      for (uint32_t start = 0; start < x.width; start += slice_size)
+      {
+        uint32_t end = std::min(start + slice_size, x.width) - 1;
+        Term y_sliced = y;
+        if (start > 0)
+        {
+          Integer shift = Integer(1).multiplyByPow2(start);
+          y_sliced = solver->mkTerm(
+              INTS_DIVISION, {y_sliced, solver->mkInteger(shift.toString())});
+        }
+        if (end + 1 < x.width)
+        {
+          Integer range = Integer(1).multiplyByPow2(end - start + 1);
+          y_sliced = solver->mkTerm(
+              INTS_MODULUS, {y_sliced, solver->mkInteger(range.toString())});
+        }
+        slice_table.push_back({y_sliced,
+                               x.var.getSymbol() + "[" + std::to_string(start)
+                                   + ":" + std::to_string(end) + "]"});
+      }
+    }
+    return;
+  }
+  if (bvs_in_projset.empty()) return;
+  uint32_t new_bv_width = getMinBW();
+  for (cvc5::Term x : bvs_in_projset)
+  {
+    uint32_t this_bv_width = x.getSort().getBitVectorSize();
+    uint32_t num_slices = getNumSlices(this_bv_width);
+    for (uint32_t slice = 0; slice < num_slices; ++slice)
+    {
+      uint32_t this_slice_start = slice * slice_size;
+      uint32_t this_slice_end = (slice + 1) * slice_size - 1;
+      // If slicesize does not divide bv width, and this is last
+      // slice, then extend this slice more than others
+      if (this_slice_end >= this_bv_width)
+      {
+        this_slice_end = this_bv_width - 1;
+      }
+      uint32_t extend_x_by_bits =
+          new_bv_width - (this_slice_end - this_slice_start + 1);
+
+      Op x_bit_op =
+          solver->mkOp(BITVECTOR_EXTRACT, {this_slice_end, this_slice_start});
+      Term x_sliced = solver->mkTerm(x_bit_op, {x});
+      Op x_zero_ex_op = solver->mkOp(BITVECTOR_ZERO_EXTEND, {extend_x_by_bits});
+      x_sliced = solver->mkTerm(x_zero_ex_op, {x_sliced});
+      std::string name = x.getSymbol() + "[" + std::to_string(this_slice_start)
+                         + ":" + std::to_string(this_slice_end) + "]";
+      slice_table.push_back({x_sliced, name});
+    }
+  }
+}
+
+Term SmtApproxMc::generateLinearSum(const HashCoeffs& h)
+{
+  cvc5::Solver* solver = d_slv->getSolver();
+  uint32_t new_bv_width = getMinBW();
+  Assert(h.a.size() == slice_table.size());
+
+  std::vector<Term> summands;
+  for (size_t i = 0, n = slice_table.size(); i < n; ++i)
+  {
+    Trace("smap-hash") << h.a[i] << slice_table[i].name << " + ";
+    if (h.a[i].isZero()) continue;
+    Term a = mkBvConst(new_bv_width, h.a[i]);
+    summands.push_back(
+        solver->mkTerm(BITVECTOR_MULT, {a, slice_table[i].term}));
+  }
+  if (summands.empty()) return solver->mkBitVector(new_bv_width, 0);
+  if (summands.size() == 1) return summands[0];
+  return solver->mkTerm(BITVECTOR_ADD, summands);
+}
+
+Term SmtApproxMc::generate_integer_hash(uint32_t hash_num)
+{
+  cvc5::Solver* solver = d_slv->getSolver();
+  uint32_t new_bv_width = getMinBW();
+
+  Term p = mkBvConst(new_bv_width, getPrime(slice_size));
+
+  const HashCoeffs& h = hash_family[hash_num];
+  const Integer& c_i = h.c;
+
+  Term maxx =
+      mkBvConst(new_bv_width, Integer(1).multiplyByPow2(slice_size + 1));
+  Term c = mkBvConst(new_bv_width, c_i);
+
+  Sort bvsort = solver->mkBitVectorSort(new_bv_width);
+  std::string var_name = "hash" + std::to_string(hash_num);
+  Term new_var = solver->mkConst(bvsort, var_name);
+  hash_vars.push_back(new_var);
+  Term new_var_mult_p = solver->mkTerm(BITVECTOR_MULT, {new_var, p});
+  Term hash_const_less = solver->mkTerm(BITVECTOR_ULT, {new_var, maxx});
+  c = solver->mkTerm(BITVECTOR_ADD, {c, new_var_mult_p});
+
+  Trace("smap-hash") << pow(2, slice_size) << "Adding Hash: (";
+
+  Term axpb = generateLinearSum(h);
+
+  Trace("smap-hash") << " 0) = " << getPrime(slice_size) << "h" << hash_num
+                     << " + " << c_i << "\n";
+
+  Term hash_const = solver->mkTerm(EQUAL, {axpb, c});
+  Trace("smap-print-hash") << "\n"
+                           << "(assert " << hash_const << ")"
+                           << "\n";
+  hash_const = solver->mkTerm(AND, {hash_const, hash_const_less});
+  Trace("smap-print-hash") << "\n"
+                           << "(assert " << hash_const_less << ")"
+                           << "\n";
+  Trace("smap-print-hash") << "\n"
+                           << "(assert " << hash_const << ")"
+                           << "\n";
+
+  return hash_const;
+}
+
+/**
+ * The hash sum_k a_k * slice_k = p * q + c over the Integers, with a fresh
+ * quotient q. As 0 <= c < p, q is determined by the slices.
+ */
+Term SmtApproxMc::generate_lia_hash(uint32_t hash_num)
+{
+  cvc5::Solver* solver = d_slv->getSolver();
+  const HashCoeffs& h = hash_family[hash_num];
+  const Integer& p = getPrime(slice_size);
+
+  Trace("smap-hash") << "Adding a hash constraint (size "
+                     << slice_table.size() << ") : (";
+  std::vector<Term> summands;
+  for (size_t i = 0, n = slice_table.size(); i < n; ++i)
+  {
+    Trace("smap-hash") << h.a[i] << slice_table[i].name << " + ";
+    if (h.a[i].isZero()) continue;
+    summands.push_back(solver->mkTerm(
+        MULT, {solver->mkInteger(h.a[i].toString()), slice_table[i].term}));
+  }
+  Trace("smap-hash") << " 0) mod " << p << " = " << h.c << "\n";
+  Term sum = summands.empty()      ? solver->mkInteger(0)
+             : summands.size() == 1 ? summands[0]
+                                    : solver->mkTerm(ADD, summands);
+
+  // Each summand is below p^2, so q < n * p
+  Term q = solver->mkConst(solver->getIntegerSort(),
+                           "hash_q" + std::to_string(hash_num));
+  Integer max_q = p * Integer(uint64_t(slice_table.size() + 1));
+  Term hash_const = solver->mkTerm(
+      AND,
+      {solver->mkTerm(
+           EQUAL,
+           {sum,
+            solver->mkTerm(ADD,
+                           {solver->mkTerm(
+                                MULT, {solver->mkInteger(p.toString()), q}),
+                            solver->mkInteger(h.c.toString())})}),
+       solver->mkTerm(GEQ, {q, solver->mkInteger(0)}),
+       solver->mkTerm(LT, {q, solver->mkInteger(max_q.toString())})});
+  Trace("smap-print-hash") << "\n"
+                           << "(assert " << hash_const << ")"
+                           << "\n";
+  return hash_const;
+}
+
+Term SmtApproxMc::generate_hash(uint32_t hash_num)
+{
+  cvc5::Solver* solver = d_slv->getSolver();
+
+  uint32_t new_bv_width = getMinBW();
+
+  Term p = mkBvConst(new_bv_width, getPrime(slice_size));
+
+  const HashCoeffs& h = hash_family[hash_num];
+  const Integer& c_i = h.c;
+
+  Term c = mkBvConst(new_bv_width, c_i);
+
+  Trace("smap-hash") << "Adding a hash constraint (size "
+                     << slice_table.size() << ") : (";
+
+  Term axpb = generateLinearSum(h);
+  Trace("smap-hash") << " 0) mod " << getPrime(slice_size) << " = " << c_i
+                     << "\n";
+
+  Term hash_const;
+  if (d_slv->getOptions().counting.hashQuotient)
+  {
+    // Instead of a division circuit, the reduction is witnessed by a fresh
+    // quotient q with axpb = q * p + c. As axpb < 2^w and p >= 2^slice_size,
+    // w - slice_size bits suffice for q, and q is determined by axpb, so it
+    // does not change the count. Two more bits keep q * p + c from
+    // overflowing.
+    uint32_t q_width = new_bv_width - slice_size;
+    uint32_t ext_width = new_bv_width + 2;
+    Term q = solver->mkConst(solver->mkBitVectorSort(q_width),
+                             "hash_q" + std::to_string(hash_num));
+    Term q_ext = solver->mkTerm(
+        solver->mkOp(BITVECTOR_ZERO_EXTEND, {ext_width - q_width}), {q});
+    Term axpb_ext =
+        solver->mkTerm(solver->mkOp(BITVECTOR_ZERO_EXTEND, {2}), {axpb});
+    Term qpc = solver->mkTerm(
+        BITVECTOR_ADD,
+        {solver->mkTerm(BITVECTOR_MULT,
+                        {mkBvConst(ext_width, getPrime(slice_size)),
+                         q_ext}),
+         mkBvConst(ext_width, c_i)});
+    hash_const = solver->mkTerm(EQUAL, {axpb_ext, qpc});
+  }
+  else
+  {
+    axpb = solver->mkTerm(BITVECTOR_UREM, {axpb, p});
+    hash_const = solver->mkTerm(EQUAL, {axpb, c});
+  }
+  Trace("smap-print-hash") << "chash "
+                           << "(assert " << hash_const << ")"
+                           << "\n";
+
+  return hash_const;
+}
+
+void SmtApproxMc::startRound()
+{
+  // Every round (including repeated failing ones) draws its hashes from its
+  // own seed, so that the rounds are independent of how they are scheduled.
+  // A round continued from a checkpoint keeps its seed.
+  if (resume_round)
+  {
+    hash_seed = d_slv->getOptions().driver.seed + ckpt.round_seed;
+    return;
+  }
+  ckpt.round_seed = num_rounds_started;
+  hash_seed = d_slv->getOptions().driver.seed + num_rounds_started;
+  num_rounds_started++;
+}
+
+/**
+ * The options that the counts of a checkpoint depend on, as written to and
+ * compared with the checkpoint.
+ */
+std::string SmtApproxMc::getCheckpointSettings()
+{
+  const Options& opts = d_slv->getOptions();
+  std::stringstream ss;
+  ss << std::setprecision(std::numeric_limits<double>::max_digits10)
+     << "epsilon " << opts.counting.epsilon << " delta " << opts.counting.delta
+     << " hashsm " << opts.counting.hashsm << " slicesize "
+     << opts.counting.slicesize << " auto-slicesize " << opts.counting.autoSlice
+     << " hash-quotient " << opts.counting.hashQuotient << " count-cubes "
+     << opts.counting.countCubes << " count-components "
+     << opts.counting.countComponents << " indep-support "
+     << opts.counting.indepSupport;
+  return ss.str();
+}
+
+/**
+ * Reads a checkpoint written by writeCheckpoint(). The run continues with
+ * the slice sizes, finished counts and rounds of the checkpoint, which must
+ * have been made with the same seed, projection, settings and assertions.
+ */
+void SmtApproxMc::readCheckpoint(const std::string& filename)
+{
+  std::ifstream in(filename);
+  std::string line, tag, settings;
+  uint64_t seed = 0, hash = 0;
+  uint32_t num_projected = 0;
+  bool has_header = false;
+  while (std::getline(in, line))
+  {
+    std::istringstream ls(line);
+    if (!(ls >> tag)) continue;
+    if (tag == "c")
+    {
+      has_header = true;
+    }
+    else if (tag == "seed")
+    {
+      ls >> seed;
+    }
+    else if (tag == "projection")
+    {
+      ls >> num_projected;
+    }
+    else if (tag == "settings")
+    {
+      std::getline(ls >> std::ws, settings);
+    }
+    else if (tag == "assertions")
+    {
+      ls >> hash;
+    }
+    else if (tag == "rounds_started")
+    {
+      ls >> num_rounds_started;
+    }
+    else if (tag == "slice")
+    {
+      uint32_t size;
+      ls >> size;
+      ckpt.slice_sizes.push_back(size);
+    }
+    else if (tag == "unit")
+    {
+      uint32_t unit;
+      std::string count;
+      Checkpoint::Unit u;
+      ls >> unit >> u.num_hashes >> u.delta >> count;
+      u.count = Integer(count);
+      ckpt.units[unit] = u;
+    }
+    else if (tag == "current")
+    {
+      ls >> ckpt.unit >> ckpt.num_hashes;
+    }
+    else if (tag == "round")
+    {
+      std::string count;
+      ls >> count;
+      ckpt.rounds.push_back(Integer(count));
+    }
+    else if (tag == "active")
+    {
+      ckpt.active = true;
+      ls >> ckpt.round_seed >> ckpt.growingphase >> ckpt.lowbound
+          >> ckpt.highbound >> ckpt.round_hashes;
+    }
+    else if (tag == "sol")
+    {
+      std::vector<std::string> values;
+      std::string v;
+      while (ls >> v)
+      {
+        values.push_back(v);
+      }
+      ckpt.solutions.push_back(values);
+    }
+    else
+    {
+      throw Exception("Unexpected line in checkpoint " + filename + ": "
+                      + line);
+    }
+  }
+  if (!has_header || seed != d_slv->getOptions().driver.seed
+      || num_projected != num_projection_vars)
+  {
+    throw Exception("Checkpoint " + filename
+                    + " was made with a different seed or projection");
+  }
+  if (settings != getCheckpointSettings())
+  {
+    throw Exception("Checkpoint " + filename
+                    + " was made with different settings: " + settings);
+  }
+  if (hash != assertions_hash)
+  {
+    throw Exception("Checkpoint " + filename
+                    + " was made for different assertions");
+  }
+  std::cout << "c [smtappmc] resuming from checkpoint " << filename << ": "
+            << ckpt.units.size() << " finished counts, "
+            << ckpt.rounds.size() << " finished rounds" << std::endl;
+}
+
+/**
+ * Writes the state of the run to the --count-resume file. The file is
+ * replaced atomically, so that a run killed while writing leaves the
+ * previous checkpoint intact.
+ */
+void SmtApproxMc::writeCheckpoint()
+{
+  const std::string& filename = d_slv->getOptions().counting.countResume;
+  if (filename.empty() || count_worker) return;
+  std::string tmp = filename + ".tmp";
+  {
+    std::ofstream out(tmp);
+    // The probabilities of failure are read back exactly
+    out << std::setprecision(std::numeric_limits<double>::max_digits10);
+    out << "c pact counting checkpoint" << std::endl;
+    out << "seed " << d_slv->getOptions().driver.seed << std::endl;
+    out << "projection " << num_projection_vars << std::endl;
+    out << "settings " << getCheckpointSettings() << std::endl;
+    out << "assertions " << assertions_hash << std::endl;
+    out << "rounds_started " << num_rounds_started << std::endl;
+    for (uint32_t size : ckpt.slice_sizes)
+    {
+      out << "slice " << size << std::endl;
+    }
+    for (const std::pair<const uint32_t, Checkpoint::Unit>& u : ckpt.units)
+    {
+      out << "unit " << u.first << " " << u.second.num_hashes << " "
+          << u.second.delta << " " << u.second.count << std::endl;
+    }
+    out << "current " << ckpt.unit << " " << ckpt.num_hashes << std::endl;
+    for (const Integer& count : ckpt.rounds)
+    {
+      out << "round " << count << std::endl;
+    }
+    if (ckpt.active)
+    {
+      out << "active " << ckpt.round_seed << " " << ckpt.growingphase << " "
+          << ckpt.lowbound << " " << ckpt.highbound << " "
+          << ckpt.round_hashes << std::endl;
+      for (const std::vector<Node>& solution : round_solutions)
+      {
+        out << "sol";
+        for (const Node& v : solution)
+        {
+          if (v.getType().isBitVector())
+            out << " " << v.getConst<BitVector>().toString(2);
+          else if (v.getType().isBoolean())
+            out << " " << (v.getConst<bool>() ? "true" : "false");
+          else
+            out << " " << v.getConst<Rational>().getNumerator();
+        }
+        out << std::endl;
+      }
+    }
+    if (!out)
+    {
+      throw Exception("Unable to write checkpoint " + tmp);
+    }
+  }
+  if (std::rename(tmp.c_str(), filename.c_str()) != 0)
+  {
+    throw Exception("Unable to replace checkpoint " + filename);
+  }
+}
+
+/**
+ * Time spent per solution by a bounded count over the cells of a few hashes
+ * of the current slice size, that together cut about half of the projected
+ * bits. All probes draw their hashes from the same seed. The count stops at
+ * a deadline budget_ms milliseconds after it started. The last call of the
+ * count, the one that found no further solution or ran out of time, is
+ * counted as one more solution, so that probes that finish and probes that
+ * time out are compared by the same milliseconds per solution.
+ */
+double SmtApproxMc::probeSliceSize(uint32_t budget_ms)
+{
+  cvc5::Solver* solver = d_slv->getSolver();
+  buildSliceTable();
+  uint32_t total_bits = 0;
+  for (cvc5::Term x : bvs_in_projset)
+  {
+    total_bits += x.getSort().getBitVectorSize();
+  }
+  for (const BoundedInt& x : ints_in_projset)
+  {
+    total_bits += x.width;
+  }
+  uint32_t probe_hashes = (total_bits / 2 + slice_size - 1) / slice_size;
+  probe_hashes = std::min(probe_hashes, getMaxHashes() - 1);
+  if (probe_hashes == 0) probe_hashes = 1;
+
+  hash_seed = d_slv->getOptions().driver.seed;
+  hash_family.clear();
+  solver->push();
+  if (ff_hashing) buildFiniteFieldBits();
+  activateHashes(probe_hashes);
+  auto start = std::chrono::steady_clock::now();
+  auto deadline = start + std::chrono::milliseconds(budget_ms);
+  if (has_deadline) deadline = std::min(deadline, count_deadline);
+  bool unfinished = false;
+  uint64_t count = d_slv->boundedSat(getPivot(),
+                                     probe_hashes,
+                                     projection_vars,
+                                     hash_assumptions,
+                                     {},
+                                     nullptr,
+                                     deadline,
+                                     &unfinished);
+  double elapsed_ms = std::chrono::duration<double, std::milli>(
+                          std::chrono::steady_clock::now() - start)
+                          .count();
+  solver->pop();
+  hash_selectors.clear();
+  hash_vars.clear();
+  ff_bits.clear();
+  ff_bit_slice.clear();
+  ff_bit_pos.clear();
+  activateHashes(0);
+  hash_family.clear();
+  Trace("smap") << "Slice size probe " << slice_size << ": " << count
+                << " solutions in " << elapsed_ms << " ms"
+                << (unfinished ? " (unfinished)" : "") << "\n";
+  return elapsed_ms / (count + 1);
+}
+
+/**
+ * Picks the slice size with the cheapest probe among a few fractions of the
+ * largest projected width, within --auto-slicesize-budget in total.
+ */
+void SmtApproxMc::tuneSliceSize()
+{
+  // The probes depend on timing, so a resumed run takes the slice size its
+  // checkpoint was made with.
+  uint32_t tune = num_tunes++;
+  if (tune < ckpt.slice_sizes.size())
+  {
+    slice_size = ckpt.slice_sizes[tune];
+    buildSliceTable();
+    std::cout << "c [smtappmc] using slice size " << slice_size
+              << " from checkpoint" << std::endl;
+    return;
+  }
+  std::vector<uint32_t> candidates;
+  for (uint32_t div : {8, 4, 2, 1})
+  {
+    uint32_t size = std::max<uint32_t>(max_bitwidth / div, 1);
+    if (std::find(candidates.begin(), candidates.end(), size)
+        == candidates.end())
+    {
+      candidates.push_back(size);
+    }
+  }
+  uint32_t budget_ms =
+      d_slv->getOptions().counting.autoSliceBudget / candidates.size();
+  if (budget_ms == 0) budget_ms = 1;
+  uint32_t best_size = slice_size;
+  double best_cost = -1;
+  for (uint32_t size : candidates)
+  {
+    slice_size = size;
+    double cost = probeSliceSize(budget_ms);
+    std::cout << "c [smtappmc] [ " << getTime()
+              << "] slice size probe: " << size << " cost: " << cost
+              << " ms/solution" << std::endl;
+    if (best_cost < 0 || cost < best_cost)
+    {
+      best_cost = cost;
+      best_size = size;
+    }
+  }
+  slice_size = best_size;
+  buildSliceTable();
+  std::cout << "c [smtappmc] using slice size " << slice_size << std::endl;
+  ckpt.slice_sizes.push_back(slice_size);
+  writeCheckpoint();
+}
+
+Integer SmtApproxMc::smtApproxMcMain()
+{
+  if (empty_int_bounds)
+  {
+    std::cout << "c [smtappmc] count is 0 since the bounds of an Integer are"
+              << " empty" << std::endl;
+    return Integer(0);
+  }
+  num_projection_vars = projection_var_terms.size();
+  const std::string& resume_from =
+      d_slv->getOptions().counting.countResumeFrom;
+  const std::string& resume = d_slv->getOptions().counting.countResume;
+  if (!resume_from.empty())
+  {
+    if (!std::ifstream(resume_from).good())
+    {
+      throw Exception("Cannot read checkpoint " + resume_from);
+    }
+    readCheckpoint(resume_from);
+  }
+  else if (!resume.empty() && std::ifstream(resume).good())
+  {
+    readCheckpoint(resume);
+  }
+  uint64_t budget = d_slv->getOptions().counting.countBudget;
+  if (budget > 0)
+  {
+    has_deadline = true;
+    count_deadline =
+        std::chrono::steady_clock::now() + std::chrono::seconds(budget);
+  }
+  double target_epsilon = epsilon;
+  if (components.empty())
+  {
+    Integer count = countProjection();
+    std::cout << "c [smtappmc] " << (count_stopped ? "partial " : "")
+              << "count within epsilon " << target_epsilon
+              << " with confidence at least " << 1 - std::min(run_delta, 1.0)
+              << std::endl;
+    std::cout << "c Total time : " << getTime() << std::endl;
+    return count;
+  }
+
+  // Each of the k components is counted with tolerance epsilon' and
+  // confidence delta / k, so that by the union bound the product is within
+  // (1 + epsilon')^k = 1 + epsilon of the count with probability at least
+  // 1 - delta. Small components need no hash and are counted exactly.
+  // The pivot grows with 1 / epsilon'^2, about k^2 times for small epsilon,
+  // which is why --count-components is not on by default.
+  size_t k = components.size();
+  epsilon = std::pow(1 + epsilon, 1.0 / k) - 1;
+  delta = delta / k;
+  std::cout << "c [smtappmc] per component epsilon: " << epsilon
+            << " delta: " << delta << " pivot: " << getPivot()
+            << " rounds: " << getNumIter() << std::endl;
+  Integer count(1);
+  for (size_t i = 0; i < k && !count.isZero(); ++i)
+  {
+    const ProjectionSet& comp = components[i];
+    bvs_in_projset = comp.bvs;
+    booleans_in_projset = comp.booleans;
+    ints_in_projset = comp.ints;
+    applyProjection();
+    ff_bits.clear();
+    ff_bit_slice.clear();
+    ff_bit_pos.clear();
+    buildSliceTable();
+    numHashes = 0;
+    std::cout << "c [smtappmc] counting component " << i + 1 << " of " << k
+              << " (" << projection_var_terms.size() << " variables)"
+              << std::endl;
+    Integer comp_count = countProjection();
+    std::cout << "c [smtappmc] component " << i + 1 << " count: "
+              << comp_count << std::endl;
+    count *= comp_count;
+  }
+  std::cout << "c [smtappmc] " << (count_stopped ? "partial " : "")
+            << "count within epsilon " << target_epsilon
+            << " with confidence at least " << 1 - std::min(run_delta, 1.0)
+            << std::endl;
+  std::cout << "c Total time : " << getTime() << std::endl;
+  return count;
+}
+
+Integer SmtApproxMc::countProjection()
+{
+  // Slices are only used by the word-level hashes
+  if (d_slv->getOptions().counting.autoSlice && !bit_hashing
+      && !project_on_booleans)
+  {
+    tuneSliceSize();
+  }
+  if (ff_hashing)
+  {
+    buildFiniteFieldBits();
+  }
+
+  uint32_t num_bits = 0;
+  while ((uint64_t(1) << num_bits) < d_slv->getOptions().counting.countCubes)
+  {
+    ++num_bits;
+  }
+  if (num_bits > 0)
+  {
+    return countCubes(num_bits);
+  }
+  return countRounds();
+}
+
+Integer SmtApproxMc::countRounds()
+{
+  uint32_t numIters;
+  numIters = getNumIter();
+  uint64_t countThisIter;
+
+  uint32_t unit = num_units++;
+  auto done = ckpt.units.find(unit);
+  if (done != ckpt.units.end())
+  {
+    numHashes = done->second.num_hashes;
+    run_delta += done->second.delta;
+    std::cout << "c [smtappmc] count " << unit
+              << " from checkpoint: " << done->second.count << std::endl;
+    return done->second.count;
+  }
+  vector<Integer> numList;
+  if (ckpt.unit == unit)
+  {
+    numList = ckpt.rounds;
+    numHashes = ckpt.num_hashes;
+    resume_round = ckpt.active;
+    if (!numList.empty() || resume_round)
+    {
+      std::cout << "c [smtappmc] continuing count " << unit << " from "
+                << numList.size() << " finished rounds"
+                << (resume_round ? " and a round in progress" : "")
+                << std::endl;
+    }
+  }
+  else
+  {
+    ckpt.unit = unit;
+    ckpt.rounds.clear();
+    ckpt.active = false;
+  }
+
+  // A finished round without hashes is exact, and so is the count
+  bool exact = !numList.empty() && numHashes == 0;
+  if (d_slv->getOptions().counting.countThreads > 1 && !count_worker)
+  {
+    // Rounds in progress in the workers are not kept
+    resume_round = false;
+    ckpt.active = false;
+    smtApproxMcParallel(numIters, numList);
+    exact = !numList.empty() && numHashes == 0;
+  }
+  else
+  {
+    for (uint32_t iter = numList.size() + 1;
+         iter <= numIters && !exact && !countStopped();
+         ++iter)
+    {
+      startRound();
+      countThisIter = smtApproxMcCore();
+      // An interrupted round stays in the checkpoint
+      if (count_stopped) break;
+      ckpt.active = false;
+      if (countThisIter == 0 && numHashes > 0)
+      {
+        std::cout << "c [smtappmc] [ " << getTime()
+                  << "] completed round: " << iter << "] failing count "
+                  << std::endl;
+        iter--;
+      }
+      else
+      {
+        std::cout << "c [smtappmc] [ " << getTime()
+                  << "] completed round: " << iter
+                  << " count: " << getRoundCount(countThisIter, numHashes)
+                  << std::endl;
+        numList.push_back(getRoundCount(countThisIter, numHashes));
+        ckpt.rounds.push_back(numList.back());
+        reportEstimate(numList, numHashes == 0);
+      }
+      ckpt.num_hashes = numHashes;
+      writeCheckpoint();
+      exact = (numHashes == 0);
+    }
+  }
+  if (numList.empty())
+  {
+    // A cube without a finished round is left out of the partial sum of
+    // countCubes()
+    if (!cube_literals.empty())
+    {
+      std::cout << "c [smtappmc] count " << unit
+                << " has no finished round, it was stopped by " << stop_reason
+                << std::endl;
+      return Integer(0);
+    }
+    throw Exception("No round of count " + std::to_string(unit)
+                    + " finished before it was stopped by " + stop_reason);
+  }
+  Integer count = findMedian(numList);
+  double unit_delta = exact ? 0 : 1 - getConfidence(numList.size());
+  run_delta += unit_delta;
+  if (count_stopped && !exact && numList.size() < numIters)
+  {
+    // Not finished, so a resumed run continues its rounds
+    std::cout << "c [smtappmc] count " << unit << " stopped by " << stop_reason
+              << " after " << numList.size() << " of " << numIters
+              << " rounds" << std::endl;
+    return count;
+  }
+  ckpt.units[unit] = Checkpoint::Unit{count, numHashes, unit_delta};
+  ckpt.rounds.clear();
+  ckpt.active = false;
+  writeCheckpoint();
+  return count;
+}
+
+/**
+ * Picks the projection bits the cubes are split on. The most significant
+ * bit of every projection variable is taken first, then the next one of
+ * each, and so on, so that the cubes cut the ranges of all variables alike.
+ * Projection Booleans are single bits and come last.
+ */
+std::vector<Term> SmtApproxMc::pickCubeBits(uint32_t num_bits)
+{
+  cvc5::Solver* solver = d_slv->getSolver();
+  std::vector<Term> bits;
+  uint32_t max_width = 0;
+  for (const Term& x : bvs_in_projset)
+  {
+    max_width = std::max(max_width, x.getSort().getBitVectorSize());
+  }
+  for (const BoundedInt& x : ints_in_projset)
+  {
+    max_width = std::max(max_width, x.width);
+  }
+  for (uint32_t level = 0; level < max_width; ++level)
+  {
+    for (const Term& x : bvs_in_projset)
+    {
+      uint32_t width = x.getSort().getBitVectorSize();
+      if (level >= width) continue;
+      if (bits.size() == num_bits) return bits;
+      uint32_t bit = width - 1 - level;
+      Op x_bit_op = solver->mkOp(BITVECTOR_EXTRACT, {bit, bit});
+      bits.push_back(solver->mkTerm(
+          EQUAL, {solver->mkTerm(x_bit_op, {x}), mkBvConst(1, Integer(1))}));
+    }
+    for (const BoundedInt& x : ints_in_projset)
+    {
+      if (level >= x.width) continue;
+      if (bits.size() == num_bits) return bits;
+      // bit i of x - lower is ((x - lower) div 2^i) mod 2
+      Integer shift = Integer(1).multiplyByPow2(x.width - 1 - level);
+      Term y = solver->mkTerm(
+          SUB, {x.var, solver->mkInteger(x.lower.toString())});
+      y = solver->mkTerm(INTS_DIVISION,
+                         {y, solver->mkInteger(shift.toString())});
+      bits.push_back(solver->mkTerm(
+          EQUAL,
+          {solver->mkTerm(INTS_MODULUS, {y, solver->mkInteger(2)}),
+           solver->mkInteger(1)}));
+    }
+  }
+  for (const Term& b : booleans_in_projset)
+  {
+    if (bits.size() == num_bits) return bits;
+    bits.push_back(b);
+  }
+  return bits;
+}
+
+void SmtApproxMc::setCube(const std::vector<Term>& split_bits, uint32_t cube)
+{
+  cube_literals.clear();
+  for (size_t i = 0, n = split_bits.size(); i < n; ++i)
+  {
+    cube_literals.push_back(((cube >> i) & 1) ? split_bits[i]
+                                              : split_bits[i].notTerm());
+  }
+  numHashes = 0;
+  Trace("smap") << "Cube " << cube << " : " << cube_literals << "\n";
+}
+
+/**
+ * Cube-and-conquer counting. The projection space is split on num_bits
+ * projection bits into disjoint cubes whose counts add up to the projected
+ * count. Each cube is counted with the usual rounds under its literals as
+ * assumptions, so a small cube needs no hash and is counted exactly by the
+ * first bounded enumeration.
+ */
+Integer SmtApproxMc::countCubes(uint32_t num_bits)
+{
+  std::vector<Term> split_bits = pickCubeBits(num_bits);
+  if (split_bits.empty())
+  {
+    return countRounds();
+  }
+  uint32_t num_cubes = 1u << split_bits.size();
+  // Each cube is counted within a factor (1 + epsilon) with confidence
+  // delta / n, and the sum of such estimates is within the same factor of
+  // the count, with probability at least 1 - delta by the union bound.
+  double saved_delta = delta;
+  delta = delta / num_cubes;
+  std::cout << "c [smtappmc] counting " << num_cubes << " cubes over "
+            << split_bits.size() << " projection bits, per cube delta: "
+            << delta << " rounds: " << getNumIter() << std::endl;
+
+  vector<Integer> counts(num_cubes);
+  if (d_slv->getOptions().counting.countThreads > 1)
+  {
+    countCubesParallel(split_bits, counts);
+  }
+  else
+  {
+    for (uint32_t cube = 0; cube < num_cubes && !countStopped(); ++cube)
+    {
+      setCube(split_bits, cube);
+      counts[cube] = countRounds();
+      std::cout << "c [smtappmc] [ " << getTime() << "] cube " << cube
+                << " count: " << counts[cube] << std::endl;
+    }
+  }
+  cube_literals.clear();
+  delta = saved_delta;
+  if (count_stopped)
+  {
+    // As for the rounds, the count so far is reported: the cubes that were
+    // not counted are missing from the sum, and the probability of failure
+    // only covers the cubes that were.
+    std::cout << "c [smtappmc] cubes stopped by " << stop_reason
+              << ", the partial count leaves out the cubes not counted"
+              << std::endl;
+  }
+
+  Integer count(0);
+  for (const Integer& c : counts)
+  {
+    count += c;
+  }
+  return count;
+}
+
+#if HAVE_SYS_WAIT_H
+
+namespace {
+
+/**
+ * Result of one round, as sent from a worker process to the parent. The
+ * parent scales the cell count by the number of cells.
+ */
+struct RoundResult
+{
+  uint64_t count;
+  int32_t numHashes;
+};
+
+}  // namespace
+
+/**
+ * Runs the rounds of SMTApproxMC in up to --count-threads forked worker
+ * processes. Each worker owns a copy of the solver state after
+ * preprocessing, runs a single round with its own seed and reports its count
+ * through a pipe. Failing rounds are rescheduled. If a round finds that no
+ * hash is needed, its count is exact and the remaining workers are stopped.
+ */
+void SmtApproxMc::smtApproxMcParallel(uint32_t numIters,
+                                      vector<Integer>& numList)
+{
+  struct Worker
   {
-    if (numHashes > oldhashes)
+    pid_t pid;
+    int fd;
+    uint32_t round;
+  };
+  uint32_t maxWorkers = d_slv->getOptions().counting.countThreads;
+  vector<Worker> running;
+  uint32_t started = 0;
+  bool exact = false;
+
+  std::cout << "c [smtappmc] running " << numIters << " rounds on "
+            << maxWorkers << " workers" << std::endl;
+
+  while (!exact
+         && ((!count_stopped
+              && numList.size() + running.size() < numIters)
+             || !running.empty()))
+  {
+    // Start as many rounds as needed and allowed
+    while (numList.size() + running.size() < numIters
+           && running.size() < maxWorkers && !countStopped())
     {
-      Trace("smap") << "Pushing Hashes : " << numHashes - oldhashes << "\n";
-      for (int i = oldhashes; i < numHashes; ++i)
+      int fds[2];
+      if (pipe(fds) == -1)
       {
-        d_slv->getSolver()->push();
-        if (project_on_booleans && get_projected_count)
-          hash = generate_boolean_hash();
-        else if (d_slv->getOptions().counting.hashsm
-                 == options::HashingMode::BV)
-          hash = generate_hash();
-        else
+        throw Exception("Unable to open pipe for counting worker");
+      }
+      startRound();
+      ++started;
+      std::cout.flush();
+      pid_t pid = fork();
+      if (pid == -1)
+      {
+        throw Exception("Unable to fork counting worker");
+      }
+      if (pid == 0)
+      {
+        close(fds[0]);
+        int rc = 1;
+        count_worker = true;
+        try
+        {
+          RoundResult res;
+          res.count = smtApproxMcCore();
+          // a stopped round has no count
+          res.numHashes = count_stopped ? -1 : numHashes;
+          if (write(fds[1], &res, sizeof(res)) == sizeof(res)) rc = 0;
+        }
+        catch (const std::exception& e)
         {
-          Assert(d_slv->getOptions().counting.hashsm
-                 == options::HashingMode::INT);
-          hash = generate_integer_hash(i);
+          std::cerr << "c [smtappmc] worker failed: " << e.what() << std::endl;
         }
-        d_slv->getSolver()->assertFormula(hash);
+        close(fds[1]);
+        std::cout.flush();
+        _exit(rc);
       }
-      oldhashes = numHashes;
+      close(fds[1]);
+      running.push_back(Worker{pid, fds[0], started});
+    }
+    if (running.empty()) continue;
+
+    // Wait for any worker to finish
+    int wstatus = 0;
+    pid_t child = wait(&wstatus);
+    if (child == -1)
+    {
+      if (errno == EINTR) continue;
+      throw Exception("Unable to wait for counting worker");
+    }
+    auto it = std::find_if(running.begin(),
+                           running.end(),
+                           [child](const Worker& w) { return w.pid == child; });
+    if (it == running.end()) continue;
+    Worker w = *it;
+    running.erase(it);
+
+    RoundResult res;
+    ssize_t cnt;
+    while ((cnt = read(w.fd, &res, sizeof(res))) == -1 && errno == EINTR)
+    {
+    }
+    close(w.fd);
+    if (cnt != sizeof(res) || !WIFEXITED(wstatus)
+        || WEXITSTATUS(wstatus) != 0)
+    {
+      throw Exception("Counting worker for round "
+                      + std::to_string(w.round) + " failed");
+    }
+    if (res.numHashes < 0)
+    {
+      // The worker shares the deadline, so it was stopped by something else
+      // if the deadline has not passed
+      if (!countStopped()) stopCount("an unknown result in a worker");
+      continue;
+    }
+    if (res.count == 0 && res.numHashes > 0)
+    {
+      std::cout << "c [smtappmc] [ " << getTime()
+                << "] completed round: " << w.round << "] failing count "
+                << std::endl;
+      continue;
     }
-    else if (numHashes < oldhashes)
+    Integer count = getRoundCount(res.count, res.numHashes);
+    std::cout << "c [smtappmc] [ " << getTime()
+              << "] completed round: " << w.round << " count: " << count
+              << std::endl;
+    numList.push_back(count);
+    // Later rounds start their search from the last hash count found
+    numHashes = res.numHashes;
+    exact = (res.numHashes == 0);
+    ckpt.rounds.push_back(count);
+    ckpt.num_hashes = numHashes;
+    writeCheckpoint();
+    reportEstimate(numList, exact);
+  }
+
+  for (const Worker& w : running)
+  {
+    kill(w.pid, SIGKILL);
+    waitpid(w.pid, nullptr, 0);
+    close(w.fd);
+  }
+}
+
+/**
+ * Counts the cubes in up to --count-threads forked worker processes, handed
+ * out in order as workers become free, so that the easy cubes finish early
+ * and the hard ones get the remaining workers. Each worker runs all rounds
+ * of its cube itself and reports the count, in decimal, through a pipe.
+ */
+void SmtApproxMc::countCubesParallel(const std::vector<Term>& split_bits,
+                                     vector<Integer>& counts)
+{
+  struct Worker
+  {
+    pid_t pid;
+    int fd;
+    uint32_t cube;
+    uint32_t unit;
+  };
+  uint32_t maxWorkers = d_slv->getOptions().counting.countThreads;
+  uint32_t num_cubes = counts.size();
+  vector<Worker> running;
+  uint32_t next_cube = 0;
+
+  std::cout << "c [smtappmc] counting " << num_cubes << " cubes on "
+            << maxWorkers << " workers" << std::endl;
+
+  while (next_cube < num_cubes || !running.empty())
+  {
+    while (next_cube < num_cubes && running.size() < maxWorkers
+           && !countStopped())
     {
-      Trace("smap") << "Poping Hashes : " << oldhashes - numHashes << "\n";
-      d_slv->getSolver()->pop(oldhashes - numHashes);
-      if (d_slv->getOptions().counting.hashsm == options::HashingMode::INT)
+      uint32_t unit = num_units++;
+      auto done = ckpt.units.find(unit);
+      if (done != ckpt.units.end())
+      {
+        counts[next_cube] = done->second.count;
+        run_delta += done->second.delta;
+        std::cout << "c [smtappmc] cube " << next_cube
+                  << " count from checkpoint: " << counts[next_cube]
+                  << std::endl;
+        ++next_cube;
+        num_rounds_started += getNumIter();
+        continue;
+      }
+      int fds[2];
+      if (pipe(fds) == -1)
+      {
+        throw Exception("Unable to open pipe for counting worker");
+      }
+      std::cout.flush();
+      pid_t pid = fork();
+      if (pid == -1)
+      {
+        throw Exception("Unable to fork counting worker");
+      }
+      if (pid == 0)
       {
-        for (int i = 0; i < oldhashes - numHashes; i++)
+        close(fds[0]);
+        int rc = 1;
+        try
+        {
+          count_worker = true;
+          num_units = unit;
+          setCube(split_bits, next_cube);
+          // the count, its probability of failure, its number of hashes
+          // and whether it finished
+          double before = run_delta;
+          Integer count = countRounds();
+          std::stringstream ss;
+          ss << count << " " << run_delta - before << " " << numHashes << " "
+             << !count_stopped;
+          std::string res = ss.str();
+          if (write(fds[1], res.c_str(), res.size())
+              == static_cast<ssize_t>(res.size()))
+          {
+            rc = 0;
+          }
+        }
+        catch (const std::exception& e)
         {
-          projection_var_terms.pop_back();  // TODO (AS) making no sense now
+          std::cerr << "c [smtappmc] worker failed: " << e.what() << std::endl;
         }
-        projection_vars =
-            d_slv->getSolver()->termVectorToNodes1(projection_var_terms);
+        close(fds[1]);
+        std::cout.flush();
+        _exit(rc);
+      }
+      close(fds[1]);
+      running.push_back(Worker{pid, fds[0], next_cube, unit});
+      ++next_cube;
+      // The rounds of the next cube use seeds of their own
+      num_rounds_started += getNumIter();
+    }
+    if (running.empty())
+    {
+      // Out of budget, the remaining cubes are not counted
+      if (next_cube < num_cubes)
+      {
+        break;
       }
+      continue;
+    }
 
-      oldhashes = numHashes;
+    int wstatus = 0;
+    pid_t child = wait(&wstatus);
+    if (child == -1)
+    {
+      if (errno == EINTR) continue;
+      throw Exception("Unable to wait for counting worker");
     }
-    else
+    auto it = std::find_if(running.begin(),
+                           running.end(),
+                           [child](const Worker& w) { return w.pid == child; });
+    if (it == running.end()) continue;
+    Worker w = *it;
+    running.erase(it);
+
+    std::string res;
+    char buf[256];
+    ssize_t cnt;
+    while ((cnt = read(w.fd, buf, sizeof(buf))) != 0)
+    {
+      if (cnt == -1)
+      {
+        if (errno == EINTR) continue;
+        break;
+      }
+      res.append(buf, cnt);
+    }
+    close(w.fd);
+    if (cnt != 0 || res.empty() || !WIFEXITED(wstatus)
+        || WEXITSTATUS(wstatus) != 0)
+    {
+      for (const Worker& r : running)
+      {
+        kill(r.pid, SIGKILL);
+        waitpid(r.pid, nullptr, 0);
+        close(r.fd);
+      }
+      throw Exception("Counting worker for cube " + std::to_string(w.cube)
+                      + " failed");
+    }
+    std::istringstream rs(res);
+    std::string count;
+    double cube_delta;
+    int cube_hashes;
+    bool finished;
+    rs >> count >> cube_delta >> cube_hashes >> finished;
+    counts[w.cube] = Integer(count);
+    run_delta += cube_delta;
+    std::cout << "c [smtappmc] [ " << getTime() << "] cube " << w.cube
+              << " count: " << counts[w.cube] << std::endl;
+    if (!finished)
+    {
+      if (!countStopped()) stopCount("an unknown result in a worker");
+      continue;
+    }
+    ckpt.units[w.unit] =
+        Checkpoint::Unit{counts[w.cube], cube_hashes, cube_delta};
+    writeCheckpoint();
+  }
+}
+
+#else
+
+void SmtApproxMc::smtApproxMcParallel(uint32_t numIters,
+                                      vector<Integer>& numList)
+{
+  throw Exception("--count-threads requires a build with fork() support");
+}
+
+void SmtApproxMc::countCubesParallel(const std::vector<Term>& split_bits,
+                                     vector<Integer>& counts)
+{
+  throw Exception("--count-threads requires a build with fork() support");
+}
+
+#endif
+
+double SmtApproxMc::getTime()
+{
+  std::stringstream s;
+  std::string time_str1;
+  s << d_slv->getSolver()->getStatistics().get("global::totalTime");
+  s >> time_str1;
+  time_str1.resize(time_str1.size() - 2);
+  const std::string time_str = time_str1;
+  double time_int = std::stod(time_str) / 1000.0;
+  return time_int;
+}
+
+vector<Node>& SmtApproxMc::get_projection_nodes() { return projection_vars; }
+
+void SmtApproxMc::addHash(uint32_t hash_num)
+{
+  cvc5::Solver* solver = d_slv->getSolver();
+  Term hash;
+  if (project_on_booleans)
+    hash = generate_boolean_hash(hash_num);
+  else if (bit_hashing)
+  {
+    // the XOR is guarded by its own activation literal
+    hash_selectors.push_back(generate_xor_hash(hash_num));
+    return;
+  }
+  else if (lia_hashing)
+    hash = generate_lia_hash(hash_num);
+  else if (d_slv->getOptions().counting.hashsm == options::HashingMode::BV)
+    hash = generate_hash(hash_num);
+  else if (ff_hashing)
+    hash = generate_ff_hash(hash_num);
+  else
+  {
+    Assert(d_slv->getOptions().counting.hashsm == options::HashingMode::INT);
+    hash = generate_integer_hash(hash_num);
+  }
+  std::string sel_name = "hash_sel" + std::to_string(hash_num);
+  Term sel = solver->mkConst(solver->getBooleanSort(), sel_name);
+  solver->assertFormula(solver->mkTerm(IMPLIES, {sel, hash}));
+  hash_selectors.push_back(sel);
+}
+
+bool SmtApproxMc::satisfiesHashes(const std::vector<Node>& solution,
+                                  uint32_t num_hashes)
+{
+  Assert(solution.size()
+         == bvs_in_projset.size() + booleans_in_projset.size()
+                + ints_in_projset.size());
+  for (uint32_t i = 0; i < num_hashes; ++i)
+  {
+    const HashCoeffs& h = hash_family[i];
+    if (project_on_booleans)
+    {
+      bool parity = h.c.isOne();
+      for (size_t j = 0, n = booleans_in_projset.size(); j < n; ++j)
+      {
+        if (h.a[j].isOne())
+        {
+          parity ^= solution[bvs_in_projset.size() + j].getConst<bool>();
+        }
+      }
+      if (!parity) return false;
+      continue;
+    }
+    if (bit_hashing)
+    {
+      bool parity = h.c.isOne();
+      size_t next_coeff = 0;
+      for (size_t j = 0, n = bvs_in_projset.size(); j < n; ++j)
+      {
+        const BitVector& x = solution[j].getConst<BitVector>();
+        for (uint32_t b = 0, w = x.getSize(); b < w; ++b)
+        {
+          if (h.a[next_coeff++].isOne()) parity ^= x.isBitSet(b);
+        }
+      }
+      for (size_t j = 0, n = booleans_in_projset.size(); j < n; ++j)
+      {
+        if (h.a[next_coeff++].isOne())
+        {
+          parity ^= solution[bvs_in_projset.size() + j].getConst<bool>();
+        }
+      }
+      if (parity) return false;
+      continue;
+    }
+    Integer sum(0);
+    size_t next_coeff = 0;
+    for (size_t j = 0, n = bvs_in_projset.size(); j < n; ++j)
+    {
+      const BitVector& x = solution[j].getConst<BitVector>();
+      uint32_t this_bv_width = x.getSize();
+      uint32_t num_slices = getNumSlices(this_bv_width);
+      for (uint32_t slice = 0; slice < num_slices; ++slice)
+      {
+        uint32_t this_slice_start = slice * slice_size;
+        uint32_t this_slice_end =
+            std::min((slice + 1) * slice_size, this_bv_width) - 1;
+        sum += h.a[next_coeff++]
+               * x.extract(this_slice_end, this_slice_start).toInteger();
+      }
+    }
+    size_t first_int = bvs_in_projset.size() + booleans_in_projset.size();
+    for (size_t j = 0, n = ints_in_projset.size(); j < n; ++j)
+    {
+      const BoundedInt& x = ints_in_projset[j];
+      Integer y = solution[first_int + j].getConst<Rational>().getNumerator()
+                  - x.lower;
+      for (uint32_t start = 0; start < x.width; start += slice_size)
+      {
+        uint32_t len = std::min(start + slice_size, x.width) - start;
+        sum += h.a[next_coeff++] * y.extractBitRange(len, start);
+      }
+    }
+    if (sum.floorDivideRemainder(getPrime(slice_size)) != h.c)
+    {
+      return false;
+    }
+  }
+  return true;
+}
+
+void SmtApproxMc::activateHashes(uint32_t num_active)
+{
+  Trace("smap") << "Activating Hashes : " << num_active << " of "
+                << hash_selectors.size() << "\n";
+  // Hashes are drawn when they are first activated
+  drawHashFamily(num_active);
+  while (hash_selectors.size() < num_active)
+  {
+    addHash(hash_selectors.size());
+  }
+  std::vector<Term> active(hash_selectors.begin(),
+                           hash_selectors.begin() + num_active);
+  active.insert(active.end(), cube_literals.begin(), cube_literals.end());
+  hash_assumptions = d_slv->getSolver()->termVectorToNodes1(active);
+
+  // The quotient variables of the INT hashes are determined by the
+  // projection variables only while their hash is active.
+  std::vector<Term> terms = projection_var_terms;
+  terms.insert(terms.end(),
+               hash_vars.begin(),
+               hash_vars.begin()
+                   + std::min<size_t>(num_active, hash_vars.size()));
+  projection_vars = d_slv->getSolver()->termVectorToNodes1(terms);
+}
+
+uint64_t SmtApproxMc::smtApproxMcCore()
+{
+  int growingphase = 1;
+  int lowbound = 1, highbound = 2;
+  int nochange = 0;
+
+  int64_t bound = getPivot();
+  int64_t count = bound;
+
+  // Each round uses one fixed sequence of hashes h_0, h_1, ..., where h_i
+  // only depends on the seed of the round and i, and m hashes are always
+  // the prefix h_0..h_{m-1}. The cells for m + 1 hashes are therefore nested
+  // in the cells for m hashes. A hash is drawn when it is first activated,
+  // so a round only holds the coefficients of the hashes its search uses.
+  hash_family.clear();
+  round_solutions.clear();
+  if (resume_round)
+  {
+    // Continue the round of the checkpoint with the state of its search and
+    // the solutions it already found. startRound() set the seed of the
+    // round, from which activateHashes() draws the same hashes again.
+    growingphase = ckpt.growingphase;
+    lowbound = ckpt.lowbound;
+    highbound = ckpt.highbound;
+    numHashes = ckpt.round_hashes;
+    for (const std::vector<std::string>& values : ckpt.solutions)
     {
-      Trace("smap") << "Strange! No change in num hashes!"
-                    << "\n";
+      std::vector<Node> solution;
+      for (size_t j = 0, n = values.size(); j < n; ++j)
+      {
+        NodeManager* nm = NodeManager::currentNM();
+        TypeNode tn = projection_vars[j].getType();
+        if (tn.isBitVector())
+          solution.push_back(nm->mkConst(BitVector(values[j], 2)));
+        else if (tn.isBoolean())
+          solution.push_back(nm->mkConst(values[j] == "true"));
+        else
+          solution.push_back(nm->mkConstInt(Rational(Integer(values[j]))));
+      }
+      round_solutions.push_back(solution);
     }
+    resume_round = false;
+  }
+  // In INT mode the solutions also contain the quotient variables of the
+  // active hashes, so they are not reused.
+  bool reuse_solutions =
+      project_on_booleans || bit_hashing || ff_hashing || lia_hashing
+      || d_slv->getOptions().counting.hashsm == options::HashingMode::BV;
+
+  // All hashes of this round are asserted once, guarded by a selector
+  // literal, in a single context level. Moving between hash counts only
+  // changes the assumptions passed to the solver.
+  d_slv->getSolver()->push();
+  hash_selectors.clear();
+  hash_vars.clear();
+
+  while (true)
+  {
+    activateHashes(numHashes);
 
     std::cout << "c [smtappmc] [ " << getTime()
               << "] bounded_sol_count looking for " << bound
               << " solutions -- hashes active: " << numHashes << std::endl;
 
-    count = d_slv->boundedSat(bound, numHashes, projection_vars);
+    // The cell for numHashes hashes is the set of solutions that satisfy the
+    // first numHashes hashes of the family, so solutions found at earlier
+    // steps of the search are checked by evaluating the hashes.
+    std::vector<std::vector<Node>> known_solutions;
+    if (reuse_solutions)
+    {
+      for (const std::vector<Node>& solution : round_solutions)
+      {
+        if (satisfiesHashes(solution, numHashes))
+        {
+          known_solutions.push_back(solution);
+        }
+      }
+      Trace("smap") << "Reusing solutions : " << known_solutions.size()
+                    << " of " << round_solutions.size() << "\n";
+    }
+
+    // With --count-budget, no call of the bounded count runs past the
+    // deadline. A count cut short by it or by an unknown result is not
+    // used, and the round is left unfinished.
+    if (countStopped()) break;
+    bool unfinished = false;
+    count = d_slv->boundedSat(
+        bound,
+        numHashes,
+        projection_vars,
+        hash_assumptions,
+        known_solutions,
+        reuse_solutions ? &round_solutions : nullptr,
+        has_deadline ? count_deadline
+                     : std::chrono::steady_clock::time_point::max(),
+        &unfinished);
+    if (countStopped()) break;
+    if (unfinished)
+    {
+      stopCount("an unknown result");
+      break;
+    }
 
     std::cout << "c [smtappmc] [ " << getTime() << "] got solutions: " << count
               << " out of " << bound << std::endl;
@@ -485,17 +2391,6 @@ uint64_t SmtApproxMc::smtApproxMcCore()
     }
     else if (count < bound)
     {
-      if (verb > 0) std::cout << "Poping Hashes : " << oldhashes << std::endl;
-      d_slv->getSolver()->pop(oldhashes);
-      if (d_slv->getOptions().counting.hashsm == options::HashingMode::INT)
-      {
-        for (int i = 0; i < oldhashes; i++)
-        {
-          projection_var_terms.pop_back();
-        }
-        projection_vars =
-            d_slv->getSolver()->termVectorToNodes1(projection_var_terms);
-      }
       break;
     }
 
@@ -509,8 +2404,6 @@ uint64_t SmtApproxMc::smtApproxMcCore()
       nochange = 0;
       if (highbound < lowbound)
       {
-        Trace("smap") << "Poping Hashes : " << oldhashes << "\n";
-        d_slv->getSolver()->pop(oldhashes);
         break;
       }
       else if (count == bound)
@@ -525,30 +2418,45 @@ uint64_t SmtApproxMc::smtApproxMcCore()
       }
       else
       {
-        Trace("smap") << "Poping Hashes : " << oldhashes << "\n";
-        d_slv->getSolver()->pop(oldhashes);
         break;
       }
       if (nochange)
       {
-        Trace("smap") << "Poping Hashes : " << oldhashes << "\n";
-        d_slv->getSolver()->pop(oldhashes);
-        return 0;
+        break;
       }
       numHashes = ceil((lowbound + highbound) / 2);
     }
-  }
 
-  for (int i = 0; i < numHashes; ++i)
-  {
-    if (project_on_booleans)
-      count *= 2;
-    else
-      count *= primes[slice_size];
+    // The next step of the search is where a resumed run continues
+    ckpt.active = true;
+    ckpt.growingphase = growingphase;
+    ckpt.lowbound = lowbound;
+    ckpt.highbound = highbound;
+    ckpt.round_hashes = numHashes;
+    writeCheckpoint();
   }
+
+  Trace("smap") << "Poping round with hashes : " << hash_selectors.size()
+                << "\n";
+  d_slv->getSolver()->pop();
+  hash_selectors.clear();
+  hash_vars.clear();
+  activateHashes(0);
+  if (nochange || count_stopped) return 0;
   return count;
 }
 
+/**
+ * The estimate of a round that found cell_count solutions in a cell of
+ * num_hashes hashes, i.e. cell_count times the number of cells.
+ */
+Integer SmtApproxMc::getRoundCount(uint64_t cell_count, uint32_t num_hashes)
+{
+  Integer base = (project_on_booleans || bit_hashing) ? Integer(2)
+                                                      : getPrime(slice_size);
+  return Integer(cell_count) * base.pow(num_hashes);
+}
+
 template <class T>
 inline T SmtApproxMc::findMedian(vector<T>& numList)
 {
@@ -562,73 +2470,5 @@ inline T SmtApproxMc::findMedian(vector<T>& numList)
   return numList[medIndex];
 }
 
-vector<Node> SmtApproxMc::generateNHashes(uint32_t numhashes)
-{
-  vector<Term> hashes;
-  vector<Node> hashes_nodes;
-  cvc5::Solver* solver = d_slv->getSolver();
-  Term bv_one = solver->mkBitVector(1u, 1u);
-
-  Assert(primes.size() >= numHashes)
-      << "Prime size = " << primes.size() << " < numHashes = " << numhashes;
-  for (uint32_t num = 0; num < numhashes; ++num)
-  {
-    std::string modulus = std::to_string(primes[num]);
-    Sort f5 = solver->mkFiniteFieldSort(modulus);
-
-    for (uint32_t bitwidth = 0; bitwidth < max_bitwidth; ++bitwidth)
-    {
-      std::string value_here = std::to_string(int(pow(2, bitwidth)));
-      ff[bitwidth] = solver->mkFiniteFieldElem(value_here, f5);
-    }
-    std::string b_s =
-        std::to_string(Random::getRandom().pick(1, primes[num] - 1));
-    std::string c_s =
-        std::to_string(Random::getRandom().pick(1, primes[num] - 1));
-    Term axpb = solver->mkFiniteFieldElem(b_s, f5);
-    Term c = solver->mkFiniteFieldElem(c_s, f5);
-    if (verb > 0) std::cout << "Adding a hash constraint (";
-    for (cvc5::Term x : bvs_in_formula)
-    {
-      uint32_t num_slices = ceil(max_bitwidth / slice_size);
-
-      for (uint32_t slice = 0; slice < num_slices; ++slice)
-      {
-        Term x_ff = solver->mkFiniteFieldElem("0", f5);
-
-        uint32_t this_slice_start = slice * slice_size;
-
-        std::string a_s =
-            std::to_string(Random::getRandom().pick(1, primes[num] - 1));
-        if (verb > 0)
-          std::cout << a_s << x.getSymbol() << "[" << this_slice_start << ":"
-                    << this_slice_start + slice_size - 1 << "] + ";
-
-        for (uint bit = this_slice_start; bit < this_slice_start + slice_size;
-             ++bit)
-        {
-          Op x_bit_op = solver->mkOp(BITVECTOR_EXTRACT, {bit, bit});
-          Term x_bit_bv = solver->mkTerm(x_bit_op, {x});
-          Term eq_test = solver->mkTerm(EQUAL, {x_bit_bv, bv_one});
-          Term ite_t = solver->mkTerm(ITE, {eq_test, ff[bit], ff[0]});
-
-          x_ff = solver->mkTerm(FINITE_FIELD_ADD, {x_ff, ite_t});
-        }
-
-        Term a = solver->mkFiniteFieldElem(a_s, f5);
-        Term ax = solver->mkTerm(FINITE_FIELD_MULT, {a, x_ff});
-        axpb = solver->mkTerm(FINITE_FIELD_ADD, {ax, axpb});
-      }
-    }
-    if (verb > 0)
-      std::cout << b_s << ") mod " << primes[num] << " = " << c_s << std::endl;
-
-    Term hash_const = solver->mkTerm(EQUAL, {axpb, c});
-    hashes.push_back(hash_const);
-  }
-  hashes_nodes = solver->termVectorToNodes1(hashes);
-  return hashes_nodes;
-}
-
 }  // namespace counting
 }  // namespace cvc5::internal
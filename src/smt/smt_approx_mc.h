@@ -15,6 +15,8 @@
  * Implementation Hash function generator needed for counting with SMTApproxMC.
  */
 
+#include <chrono>
+#include <map>
 #include <vector>
 
 #include "cvc5_private.h"
@@ -24,6 +26,7 @@
 
 #include "expr/node_algorithm.h"
 #include "smt/env_obj.h"
+#include "util/integer.h"
 #include "util/statistics_stats.h"
 
 using std::vector;
@@ -41,34 +44,213 @@ class SmtApproxMc
   uint32_t num_floats = 0, num_real = 0, num_integer = 0;
   uint32_t num_bv_projset = 0, num_bool_projset = 0;
   uint32_t slice_size = 2;
-  int numHashes = 0, oldhashes = 0;
-  vector<uint64_t> primes;
+  int numHashes = 0;
+  uint32_t num_rounds_started = 0;
+  /** Cache of getPrime(), by number of bits. */
+  std::map<uint32_t, Integer> primes;
   std::unordered_set<Node> bvnodes_in_formula;
   std::vector<Node> bvnode_in_formula_v, projection_vars;
   std::vector<Term> bvs_in_projset, booleans_in_projset;
   std::vector<Term> bvs_in_formula, vars_in_formula, booleans_in_formula;
-  Term ff[100];
   int verb = 0;
+  double epsilon = 0.8, delta = 0.2;
   std::string projection_prefix;
   bool project_on_booleans = true;
   bool get_projected_count = false;
   std::vector<Term> projection_var_terms;
+  /** Random coefficients and constant of one hash. */
+  struct HashCoeffs
+  {
+    std::vector<Integer> a;
+    Integer c;
+  };
+  /**
+   * A slice of a projection bit-vector, zero-extended to getMinBW(), or an
+   * Integer slice if lia_hashing.
+   */
+  struct SliceTerm
+  {
+    Term term;
+    std::string name;
+  };
+  /**
+   * The slices of all projection bit-vectors, in the order the hash
+   * coefficients are drawn. Built once, shared by every hash of every round.
+   */
+  std::vector<SliceTerm> slice_table;
+  /** With --hashsm=xor, hashes are parity constraints over bits. */
+  bool bit_hashing = false;
+  /** The bits of all projection bit-vectors, as 1-bit extracts. */
+  std::vector<Term> bit_terms;
+  /** With --hashsm=ff, hashes are linear equations over a prime field. */
+  bool ff_hashing = false;
+  Sort ff_sort;
+  /**
+   * One field variable per projection bit, constrained to be 0 or 1 and to
+   * be 1 iff the bit is set, with the slice (in slice_table) it belongs to
+   * and its position in the slice.
+   */
+  std::vector<Term> ff_bits;
+  std::vector<uint32_t> ff_bit_slice, ff_bit_pos;
+  /** A projection Integer with the bounds lower <= x < lower + 2^width. */
+  struct BoundedInt
+  {
+    Term var;
+    Integer lower;
+    uint32_t width;
+  };
+  std::vector<BoundedInt> ints_in_projset;
+  /** Whether the bounds of an Integer projection variable are contradictory. */
+  bool empty_int_bounds = false;
+  /**
+   * With Integer projection variables in the current projection set, hashes
+   * are linear equations modulo a prime over Integer slices, and the slices
+   * of the bit-vectors in slice_table are converted to Integers. This and
+   * the other hash kinds are chosen per projection set by applyProjection().
+   */
+  bool lia_hashing = false;
+  /** Floating-point projection variables and their IEEE bit-vectors. */
+  std::vector<std::pair<Term, Term>> fp_links;
+  /** A set of projection variables. */
+  struct ProjectionSet
+  {
+    std::vector<Term> bvs, booleans;
+    std::vector<BoundedInt> ints;
+  };
+  /**
+   * With --count-components, the groups of projection variables that share
+   * no assertion, counted one after the other. Empty if there is only one.
+   */
+  std::vector<ProjectionSet> components;
+  /**
+   * The hashes of the current round drawn so far, h_0 h_1 ... Hash h_i is
+   * drawn from a generator seeded with hash_seed and i.
+   */
+  std::vector<HashCoeffs> hash_family;
+  uint64_t hash_seed = 0;
+  /** Selector literals of the hashes of the current round. */
+  std::vector<Term> hash_selectors;
+  /** Quotient variables introduced by the INT hashes of the current round. */
+  std::vector<Term> hash_vars;
+  /** Selectors of the active hashes, passed as assumptions to boundedSat. */
+  std::vector<Node> hash_assumptions;
+  /** Projection values of all solutions found in the current round. */
+  std::vector<std::vector<Node>> round_solutions;
+  /**
+   * With --count-cubes, the literals fixing the projection bits of the cube
+   * being counted, passed as assumptions together with the hash selectors.
+   */
+  std::vector<Term> cube_literals;
+  /**
+   * Whether this is a forked worker counting a round or a cube. Workers do
+   * not start workers of their own and do not write checkpoints.
+   */
+  bool count_worker = false;
+  /** State kept in the --count-resume file. */
+  struct Checkpoint
+  {
+    /** A finished count of a component or a cube. */
+    struct Unit
+    {
+      Integer count;
+      int num_hashes;
+      /** The probability that the count is not within the tolerance. */
+      double delta;
+    };
+    /** Slice sizes picked by the calls of tuneSliceSize(), in order. */
+    std::vector<uint32_t> slice_sizes;
+    /** Finished counts, by unit (the calls of countRounds(), in order). */
+    std::map<uint32_t, Unit> units;
+    /** The unit being counted, the estimates of its finished rounds. */
+    uint32_t unit = 0;
+    std::vector<Integer> rounds;
+    int num_hashes = 0;
+    /**
+     * The round in progress, if active: its seed, the state of the search
+     * for the number of hashes and the values of the solutions it found.
+     * Its hashes are drawn again from the seed when it is resumed.
+     */
+    bool active = false;
+    uint32_t round_seed = 0;
+    int growingphase = 1, lowbound = 1, highbound = 2, round_hashes = 0;
+    std::vector<std::vector<std::string>> solutions;
+  };
+  Checkpoint ckpt;
+  /** Whether the next round continues the active round of ckpt. */
+  bool resume_round = false;
+  uint32_t num_units = 0, num_tunes = 0;
+  /** Size of the whole projection, checked when resuming. */
+  uint32_t num_projection_vars = 0;
+  /** Hash of the input assertions, checked when resuming. */
+  uint64_t assertions_hash = 0;
+  /** With --count-budget, the time at which counting stops. */
+  std::chrono::steady_clock::time_point count_deadline;
+  bool has_deadline = false;
+  /**
+   * Whether counting stopped before it finished, because --count-budget ran
+   * out or a bounded count got an unknown result, as told by stop_reason.
+   */
+  bool count_stopped = false;
+  std::string stop_reason;
+  /**
+   * Sum of the probabilities of failure of the counts made so far, which
+   * bounds the one of their product or sum.
+   */
+  double run_delta = 0;
 
  public:
   SmtApproxMc(SolverEngine* slv);
   virtual ~SmtApproxMc() {}
 
-  void populatePrimes();
-  vector<Node> generateNHashes(uint32_t numHashes);
-  Term generate_boolean_hash();
-  Term generate_hash();
+  const Integer& getPrime(uint32_t bits);
+  Term mkBvConst(uint32_t width, const Integer& value);
+  uint32_t getNumSlices(uint32_t bv_width);
+  uint32_t getMaxHashes();
+  HashCoeffs drawHash(uint32_t hash_num);
+  void drawHashFamily(uint32_t num_hashes);
+  void buildSliceTable();
+  Term generateLinearSum(const HashCoeffs& h);
+  Term generate_boolean_hash(uint32_t hash_num);
+  Term generate_hash(uint32_t hash_num);
   Term generate_integer_hash(uint32_t hash_num);
-  uint64_t smtApproxMcMain();
+  Term generate_xor_hash(uint32_t hash_num);
+  void buildFiniteFieldBits();
+  void applyProjection();
+  void findComponents(const std::vector<Node>& assertions);
+  void minimizeSupport(const std::vector<Node>& assertions);
+  void addFloatingPointBits(const std::vector<Term>& floats);
+  void inferIntegerBounds(const std::vector<Node>& assertions,
+                          const std::vector<Term>& ints);
+  Term generate_lia_hash(uint32_t hash_num);
+  Term generate_ff_hash(uint32_t hash_num);
+  double probeSliceSize(uint32_t budget_ms);
+  void tuneSliceSize();
+  Integer smtApproxMcMain();
+  Integer countProjection();
+  Integer countRounds();
+  std::vector<Term> pickCubeBits(uint32_t num_bits);
+  void setCube(const std::vector<Term>& split_bits, uint32_t cube);
+  Integer countCubes(uint32_t num_bits);
+  void countCubesParallel(const std::vector<Term>& split_bits,
+                          vector<Integer>& counts);
+  void startRound();
+  void readCheckpoint(const std::string& filename);
+  void writeCheckpoint();
+  std::string getCheckpointSettings();
+  void smtApproxMcParallel(uint32_t numIters, vector<Integer>& numList);
   uint64_t getMinBW();
   uint64_t smtApproxMcCore();
+  Integer getRoundCount(uint64_t cell_count, uint32_t num_hashes);
+  void addHash(uint32_t hash_num);
+  void activateHashes(uint32_t num_active);
+  bool satisfiesHashes(const std::vector<Node>& solution, uint32_t num_hashes);
   uint32_t getPivot();
   vector<Node>& get_projection_nodes();
   uint32_t getNumIter();
+  double getConfidence(uint32_t t);
+  bool countStopped();
+  void stopCount(const std::string& reason);
+  void reportEstimate(vector<Integer>& numList, bool exact);
   template <class T>
   T findMedian(vector<T>& numList);
   double getTime();
@@ -23,6 +23,7 @@
 #include "expr/bound_var_manager.h"
 #include "expr/node.h"
 #include "expr/node_algorithm.h"
+#include "expr/skolem_manager.h"
 #include "expr/subtype_elim_node_converter.h"
 #include "options/base_options.h"
 #include "options/counting_options.h"
@@ -63,6 +64,7 @@
 #include "smt/solver_engine_stats.h"
 #include "smt/sygus_solver.h"
 #include "smt/unsat_core_manager.h"
+#include "theory/bv/theory_bv.h"
 #include "theory/quantifiers/instantiation_list.h"
 #include "theory/quantifiers/oracle_engine.h"
 #include "theory/quantifiers/quantifiers_attributes.h"
@@ -70,6 +72,7 @@
 #include "theory/rewriter.h"
 #include "theory/smt_engine_subsolver.h"
 #include "theory/theory_engine.h"
+#include "util/bitvector.h"
 #include "util/random.h"
 #include "util/rational.h"
 #include "util/resource_manager.h"
@@ -702,19 +705,84 @@ QuantifiersEngine* SolverEngine::getAvailableQuantifiersEngine(
 
 // bound = 0 is no bound
 
-int32_t SolverEngine::boundedSat(uint64_t bound,
-                                 int num_hashes,
-                                 const std::vector<Node>& terms_to_block)
+int32_t SolverEngine::boundedSat(
+    uint64_t bound,
+    int num_hashes,
+    const std::vector<Node>& terms_to_block,
+    const std::vector<Node>& assumptions,
+    const std::vector<std::vector<Node>>& known_solutions,
+    std::vector<std::vector<Node>>* solutions,
+    std::chrono::steady_clock::time_point deadline,
+    bool* unfinished)
 {
   uint64_t count = 0;
+  bool has_deadline = deadline != std::chrono::steady_clock::time_point::max();
+  if (unfinished != nullptr)
+  {
+    *unfinished = false;
+  }
   Result res;
   const Options& opts = d_env->getOptions();
+  // SMTApproxMC asserts hash selectors (and quotient variables), which
+  // are symbols of the assertions, so it must block on the projection
+  // variables only.
+  bool blockProjection = opts.counting.projcount || opts.counting.smtapproxMC
+                         || opts.counting.hashsm == options::HashingMode::INT;
+  Assert(blockProjection || (known_solutions.empty() && solutions == nullptr));
+  // Bit literals of the projection variables, computed at the first
+  // solution, once the assertions have been preprocessed.
+  std::vector<std::vector<Node>> bits;
+  bool useBits = blockProjection && canBlockProjectionBits(terms_to_block);
   push();
-  do
+  // Known solutions of this cell are counted and blocked without a SAT call.
+  for (const std::vector<Node>& values : known_solutions)
+  {
+    if (bound != 0 && count >= bound)
+    {
+      break;
+    }
+    finishInit();
+    if (useBits)
+    {
+      blockProjectionBits(terms_to_block, values, bits);
+    }
+    else
+    {
+      blockProjectionValues(terms_to_block, values);
+    }
+    count++;
+  }
+  Trace("satcall-time") << "c reused " << num_hashes << "," << count
+                        << std::endl;
+  while (bound == 0 || count < bound)
   {
+    // Each call gets the time left until the deadline, if it is shorter
+    // than the time limit per call.
+    uint64_t old_limit = opts.base.perCallMillisecondLimit;
+    if (has_deadline)
+    {
+      auto now = std::chrono::steady_clock::now();
+      if (now >= deadline)
+      {
+        if (unfinished != nullptr)
+        {
+          *unfinished = true;
+        }
+        break;
+      }
+      uint64_t remaining_ms =
+          std::chrono::duration_cast<std::chrono::milliseconds>(deadline - now)
+              .count()
+          + 1;
+      if (old_limit == 0 || remaining_ms < old_limit)
+      {
+        setTimeLimit(remaining_ms);
+      }
+    }
     auto time_before = std::chrono::high_resolution_clock::now();
     // getSolver()->getStatistics().get("global::totalTime");
-    res = checkSat();
+    res = checkSat(assumptions);
+    setTimeLimit(old_limit);
     auto time_after = std::chrono::high_resolution_clock::now();
     auto time_elapsed = std::chrono::duration_cast<std::chrono::microseconds>(
                             time_after - time_before)
@@ -723,26 +791,227 @@ int32_t SolverEngine::boundedSat(uint64_t bound,
 
     Trace("satcall-time") << "c it " << num_hashes << "," << count + 1 << ","
                           << elapsed_time_in_ms << std::endl;
-    if (res.getStatus() == Result::SAT)
+    if (res.getStatus() != Result::SAT)
+    {
+      // Unlike unsat, unknown does not mean that the cell has no further
+      // solution
+      if (res.getStatus() == Result::UNKNOWN && unfinished != nullptr)
+      {
+        *unfinished = true;
+      }
+      break;
+    }
+    finishInit();
+    if (blockProjection)
     {
-      finishInit();
-      if (opts.counting.projcount
-          || opts.counting.hashsm == options::HashingMode::INT)
+      std::vector<Node> values = getProjectionValues(terms_to_block);
+      if (solutions != nullptr)
+      {
+        solutions->push_back(values);
+      }
+      if (useBits)
       {
-        blockModelValues(terms_to_block);
+        blockProjectionBits(terms_to_block, values, bits);
       }
       else
       {
-        blockModel(cvc5::modes::BlockModelsMode::VALUES);
+        blockProjectionValues(terms_to_block, values);
       }
-      count++;
     }
-  } while (res.getStatus() == Result::SAT && (count < bound || bound == 0) );
+    else
+    {
+      blockModel(cvc5::modes::BlockModelsMode::VALUES);
+    }
+    count++;
+  }
   pop();
 
   return count;
 }
 
+Integer SolverEngine::enumerateCubes(const std::vector<Node>& terms_to_block)
+{
+  // A cube is checked against the negated assertions, which only shows
+  // that it is all solutions if the assertions are determined by the
+  // projection.
+  std::vector<Node> assertions = getAssertions();
+  std::unordered_set<Node> syms;
+  for (const Node& a : assertions)
+  {
+    expr::getSymbols(a, syms);
+  }
+  std::unordered_set<Node> proj(terms_to_block.begin(), terms_to_block.end());
+  bool generalize = true;
+  for (const Node& e : terms_to_block)
+  {
+    TypeNode tn = e.getType();
+    generalize = generalize && (tn.isBoolean() || tn.isBitVector());
+  }
+  for (const Node& s : syms)
+  {
+    generalize = generalize && proj.find(s) != proj.end();
+  }
+  if (!generalize)
+  {
+    Trace("smap") << "Cube enumeration needs all symbols in the projection"
+                  << std::endl;
+    bool unfinished = false;
+    Integer count(boundedSat(0,
+                             0,
+                             terms_to_block,
+                             {},
+                             {},
+                             nullptr,
+                             std::chrono::steady_clock::time_point::max(),
+                             &unfinished));
+    if (unfinished)
+    {
+      throw Exception("Enumeration got an unknown result after "
+                      + count.toString() + " solutions");
+    }
+    return count;
+  }
+
+  NodeManager* nm = NodeManager::currentNM();
+  SkolemManager* sm = nm->getSkolemManager();
+  Node one = nm->mkConst(BitVector(1, 1u));
+  std::vector<Node> bits;
+  for (const Node& e : terms_to_block)
+  {
+    if (e.getType().isBoolean())
+    {
+      bits.push_back(e);
+      continue;
+    }
+    for (uint32_t i = 0, size = e.getType().getBitVectorSize(); i < size; ++i)
+    {
+      Node ext = nm->mkNode(nm->mkConst(BitVectorExtract(i, i)), e);
+      bits.push_back(ext.eqNode(one));
+    }
+  }
+
+  // The checker has the assertion (or (not F) hit_0) and, for each counted
+  // cube C_k, (=> hit_k (or C_k hit_{k+1})). Under the assumption
+  // (not hit_n), a cube is unsat iff it only has solutions that are not
+  // counted yet.
+  std::unique_ptr<SolverEngine> checker;
+  theory::initializeSubsolver(checker, *d_env);
+  checker->setOption("incremental", "true");
+  checker->setOption("produce-unsat-assumptions", "true");
+  Node hit = sm->mkDummySkolem("cube_hit", nm->booleanType());
+  checker->assertFormula(
+      nm->mkNode(kind::OR, nm->mkAnd(assertions).notNode(), hit));
+
+  // Counted cubes are blocked by a clause added to the SAT solver directly,
+  // as boundedSat does, if possible.
+  bool useBits = canBlockProjectionBits(terms_to_block);
+  std::vector<std::vector<Node>> blockBits;
+  Integer count(0);
+  uint64_t num_cubes = 0;
+  push();
+  while (true)
+  {
+    Result res = checkSat();
+    if (res.getStatus() == Result::UNKNOWN)
+    {
+      pop();
+      throw Exception("Enumeration got an unknown result after "
+                      + count.toString() + " solutions in "
+                      + std::to_string(num_cubes) + " cubes");
+    }
+    if (res.getStatus() != Result::SAT)
+    {
+      break;
+    }
+    finishInit();
+    std::vector<Node> values = getProjectionValues(terms_to_block);
+    std::vector<Node> cube;
+    for (size_t i = 0, k = 0, size = terms_to_block.size(); i < size; ++i)
+    {
+      if (values[i].getType().isBoolean())
+      {
+        const Node& lit = bits[k++];
+        cube.push_back(values[i].getConst<bool>() ? lit : lit.notNode());
+        continue;
+      }
+      const BitVector& bv = values[i].getConst<BitVector>();
+      for (uint32_t j = 0, w = bv.getSize(); j < w; ++j)
+      {
+        const Node& lit = bits[k++];
+        cube.push_back(bv.isBitSet(j) ? lit : lit.notNode());
+      }
+    }
+
+    std::vector<Node> assumptions = cube;
+    assumptions.push_back(hit.notNode());
+    // The bits of the cube, all of them unless it is generalized
+    std::vector<bool> keep(cube.size(), true);
+    if (checker->checkSat(assumptions).getStatus() == Result::UNSAT)
+    {
+      std::vector<Node> core = checker->getUnsatAssumptions();
+      std::unordered_set<Node> in_core(core.begin(), core.end());
+      std::vector<Node> gen;
+      for (size_t k = 0, size = cube.size(); k < size; ++k)
+      {
+        keep[k] = in_core.find(cube[k]) != in_core.end();
+        if (keep[k])
+        {
+          gen.push_back(cube[k]);
+        }
+      }
+      cube = gen;
+    }
+    // otherwise the cube is only the model, which is a single solution
+
+    count += Integer(1).multiplyByPow2(bits.size() - cube.size());
+    num_cubes++;
+    Trace("smap") << "Cube " << num_cubes << " with " << cube.size() << " of "
+                  << bits.size() << " bits, count now " << count << std::endl;
+    Node cube_node = nm->mkAnd(cube);
+    if (useBits)
+    {
+      blockProjectionBits(terms_to_block, values, blockBits, keep);
+    }
+    else
+    {
+      assertFormulaInternal(cube_node.notNode());
+    }
+    Node next = sm->mkDummySkolem("cube_hit", nm->booleanType());
+    checker->assertFormula(
+        nm->mkNode(kind::IMPLIES, hit, nm->mkNode(kind::OR, cube_node, next)));
+    hit = next;
+  }
+  pop();
+  Trace("smap") << "Counted " << count << " solutions in " << num_cubes
+                << " cubes" << std::endl;
+  return count;
+}
+
+bool SolverEngine::getBitblastModelCount(Integer& count)
+{
+  TheoryEngine* te = d_smtSolver->getTheoryEngine();
+  Assert(te != nullptr);
+  theory::bv::TheoryBV* tbv = static_cast<theory::bv::TheoryBV*>(
+      te->theoryOf(theory::THEORY_BV));
+  return tbv->getModelCount(count);
+}
+
+bool SolverEngine::assertBitXor(const std::vector<Node>& bits, bool rhs)
+{
+  finishInit();
+  TheoryEngine* te = d_smtSolver->getTheoryEngine();
+  Assert(te != nullptr);
+  theory::bv::TheoryBV* tbv = static_cast<theory::bv::TheoryBV*>(
+      te->theoryOf(theory::THEORY_BV));
+  std::vector<Node> sbits;
+  for (const Node& bit : bits)
+  {
+    Node sbit = d_smtSolver->getPreprocessor()->applySubstitutions(bit);
+    sbits.push_back(d_env->getRewriter()->rewrite(sbit));
+  }
+  return tbv->assertBitXor(sbits, rhs);
+}
+
 Result SolverEngine::checkSat()
 {
   Node nullNode;
@@ -1200,6 +1469,121 @@ void SolverEngine::blockModelValues(const std::vector<Node>& exprs)
   assertFormulaInternal(eblocker);
 }
 
+std::vector<Node> SolverEngine::getProjectionValues(
+    const std::vector<Node>& exprs)
+{
+  TheoryModel* m = getAvailableModel("get projection values");
+  Preprocessor* pp = d_smtSolver->getPreprocessor();
+  std::vector<Node> values;
+  for (const Node& e : exprs)
+  {
+    values.push_back(m->getValue(pp->applySubstitutions(e)));
+    Assert(values.back().isConst());
+  }
+  return values;
+}
+
+void SolverEngine::blockProjectionValues(const std::vector<Node>& exprs,
+                                         const std::vector<Node>& values)
+{
+  Assert(exprs.size() == values.size());
+  std::vector<Node> blockers;
+  for (size_t i = 0, size = exprs.size(); i < size; ++i)
+  {
+    blockers.push_back(exprs[i].eqNode(values[i]).notNode());
+  }
+  Node eblocker = NodeManager::currentNM()->mkOr(blockers);
+  Trace("smap-deep") << "Block projection: " << eblocker << std::endl;
+  assertFormulaInternal(eblocker);
+}
+
+bool SolverEngine::canBlockProjectionBits(const std::vector<Node>& exprs)
+{
+  if (d_env->isSatProofProducing())
+  {
+    return false;
+  }
+  for (const Node& e : exprs)
+  {
+    TypeNode tn = e.getType();
+    if (!tn.isBoolean() && !tn.isBitVector())
+    {
+      return false;
+    }
+  }
+  return true;
+}
+
+void SolverEngine::blockProjectionBits(const std::vector<Node>& exprs,
+                                       const std::vector<Node>& values,
+                                       std::vector<std::vector<Node>>& bits,
+                                       const std::vector<bool>& keep)
+{
+  Assert(exprs.size() == values.size());
+  Preprocessor* pp = d_smtSolver->getPreprocessor();
+
+  // We add literals and clauses to the SAT solver directly, so it must be
+  // back at decision level 0, which the pending postsolve ensures.
+  d_ctxManager->doPendingPops();
+
+  NodeManager* nm = NodeManager::currentNM();
+  PropEngine* pe = d_smtSolver->getPropEngine();
+  if (bits.empty())
+  {
+    Node one = nm->mkConst(BitVector(1, 1u));
+    for (const Node& e : exprs)
+    {
+      std::vector<Node> ebits;
+      Node se = pp->applySubstitutions(e);
+      if (e.getType().isBoolean())
+      {
+        ebits.push_back(pe->ensureLiteral(se));
+      }
+      else
+      {
+        for (uint32_t i = 0, size = e.getType().getBitVectorSize(); i < size;
+             ++i)
+        {
+          Node ext = nm->mkNode(nm->mkConst(BitVectorExtract(i, i)), se);
+          ebits.push_back(pe->ensureLiteral(ext.eqNode(one)));
+        }
+      }
+      bits.push_back(ebits);
+    }
+  }
+  Assert(exprs.size() == bits.size());
+
+  std::vector<Node> clause;
+  for (size_t i = 0, k = 0, size = exprs.size(); i < size; ++i)
+  {
+    for (size_t j = 0, nbits = bits[i].size(); j < nbits; ++j, ++k)
+    {
+      if (!keep.empty() && !keep[k])
+      {
+        continue;
+      }
+      bool val = values[i].getType().isBoolean()
+                     ? values[i].getConst<bool>()
+                     : values[i].getConst<BitVector>().isBitSet(j);
+      const Node& lit = bits[i][j];
+      if (lit.isConst())
+      {
+        // the bit is fixed by preprocessing, it cannot differ
+        Assert(lit.getConst<bool>() == val);
+        continue;
+      }
+      clause.push_back(val ? lit.notNode() : lit);
+    }
+  }
+  Trace("smap-deep") << "Block projection bits: " << clause << std::endl;
+  if (clause.empty())
+  {
+    assertFormulaInternal(nm->mkConst(false));
+    return;
+  }
+  pe->assertClause(clause);
+}
+
 std::pair<Node, Node> SolverEngine::getSepHeapAndNilExpr(void)
 {
   if (!getLogicInfo().isTheoryEnabled(THEORY_SEP))
@@ -51,6 +51,7 @@ class UnsatCore;
 class StatisticsRegistry;
 class Printer;
 class ResourceManager;
+class Integer;
 struct InstantiationList;
 
 /* -------------------------------------------------------------------------- */
@@ -324,7 +325,60 @@ class CVC5_EXPORT SolverEngine
    * @throw Exception
    */
   Result checkSat();
-  int32_t boundedSat(uint64_t bound, int num_hashes, const std::vector<Node>& terms_to_block);
+  /**
+   * Count up to bound solutions (0 is no bound), blocking each solution on
+   * the values of terms_to_block. Solutions are searched under the given
+   * assumptions, which is how SMTApproxMC activates its hash constraints.
+   * The known_solutions (values of terms_to_block) must be solutions under
+   * the assumptions; they are counted and blocked first without calling the
+   * SAT solver. If solutions is given, the values of the solutions found by
+   * the SAT solver are appended to it. No call runs past the deadline. A
+   * count cut short by the deadline or by a call that returned unknown is
+   * only a lower bound of the count up to bound; if unfinished is given, it
+   * is set to whether that happened.
+   */
+  int32_t boundedSat(
+      uint64_t bound,
+      int num_hashes,
+      const std::vector<Node>& terms_to_block,
+      const std::vector<Node>& assumptions = {},
+      const std::vector<std::vector<Node>>& known_solutions = {},
+      std::vector<std::vector<Node>>* solutions = nullptr,
+      std::chrono::steady_clock::time_point deadline =
+          std::chrono::steady_clock::time_point::max(),
+      bool* unfinished = nullptr);
+  /**
+   * Count all solutions, projected on terms_to_block, by enumerating
+   * disjoint cubes over the bits of terms_to_block. Each model is
+   * generalized to the bits of an unsat core of the model bits against the
+   * negated assertions and the cubes found so far, and the cube is counted
+   * as 2^(free bits) solutions. If the assertions have symbols other than
+   * terms_to_block, or terms_to_block are not Booleans and bit-vectors, this
+   * falls back to boundedSat(0, 0, terms_to_block).
+   *
+   * @throw Exception if a call returns unknown, since the count would miss
+   * the solutions not enumerated yet
+   */
+  Integer enumerateCubes(const std::vector<Node>& terms_to_block);
+  /**
+   * Get the model count computed by the last checkSat() when bit-blasting to
+   * ApproxMC (--blast-apxmc), projected on the --projcount variables.
+   *
+   * @return false if no count was computed.
+   */
+  bool getBitblastModelCount(Integer& count);
+  /**
+   * Assert that the parity of the given 1-bit bit-vector terms is rhs,
+   * directly to the bit-blasting BV solver, where it becomes a native XOR
+   * clause if the BV SAT back end supports it. This is how SMTApproxMC adds
+   * bit-level hashes (--hashsm=xor). The constraint belongs to the current
+   * user-context level. After pop() it is left in the SAT back end until the
+   * BV solver rebuilds its SAT solver, before the next constraint is added
+   * or at a check.
+   *
+   * @return false if the BV solver does not support bit-level constraints.
+   */
+  bool assertBitXor(const std::vector<Node>& bits, bool rhs);
   Result modelCount();
   Result checkSat(const Node& assumption);
   Result checkSat(const std::vector<Node>& assumptions);
@@ -919,6 +973,38 @@ class CVC5_EXPORT SolverEngine
    * this method was called.
    */
   theory::TheoryModel* getAvailableModel(const char* c) const;
+  /**
+   * Get the current model values of the projection variables in exprs.
+   */
+  std::vector<Node> getProjectionValues(const std::vector<Node>& exprs);
+  /**
+   * Block the given values of the projection variables in exprs by asserting
+   * (or (not (= exprs[0] values[0])) ... (not (= exprs[n] values[n]))).
+   * Used by boundedSat, this skips the well-formedness checks and the
+   * computation of the substituted assertions done by blockModelValues.
+   */
+  void blockProjectionValues(const std::vector<Node>& exprs,
+                             const std::vector<Node>& values);
+  /**
+   * Can the projection variables in exprs be blocked with
+   * blockProjectionBits? This requires every projection variable to be a
+   * Boolean or a bit-vector, and SAT proofs to be disabled.
+   */
+  bool canBlockProjectionBits(const std::vector<Node>& exprs);
+  /**
+   * Block the given values of the projection variables in exprs with a
+   * single clause that is added directly to the SAT solver. The clause is
+   * over the bit literals of the projection variables: x itself for a Boolean
+   * x, and (= ((_ extract i i) x) #b1) for every bit i of a bit-vector x. They
+   * are computed on the first call (when bits is empty) and cached in bits.
+   * If keep is not empty, only the bits k (counting all bits of exprs in
+   * order) with keep[k] set are blocked, i.e., the clause blocks the cube of
+   * these bits.
+   */
+  void blockProjectionBits(const std::vector<Node>& exprs,
+                           const std::vector<Node>& values,
+                           std::vector<std::vector<Node>>& bits,
+                           const std::vector<bool>& keep = {});
   /**
    * Get available quantifiers engine, which throws a modal exception if it
    * does not exist. This can happen if a quantifiers-specific call (e.g.
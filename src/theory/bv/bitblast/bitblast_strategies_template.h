@@ -377,6 +377,50 @@ void DefaultMultBB (TNode node, std::vector<T>& res, TBitblaster<T>* bb) {
     
   // }
   
+  // Multiplication by constants (as in the hash constraints of model
+  // counting) only needs an adder per non-zero signed digit of the constant.
+  bool hasConst = false, allConst = true;
+  BitVector c;
+  for (const Node& child : node)
+  {
+    if (child.isConst())
+    {
+      c = hasConst ? c * child.getConst<BitVector>()
+                   : child.getConst<BitVector>();
+      hasConst = true;
+    }
+    else
+    {
+      allConst = false;
+    }
+  }
+  if (hasConst && !allConst)
+  {
+    std::vector<T> prod;
+    for (const Node& child : node)
+    {
+      if (child.isConst()) continue;
+      std::vector<T> current;
+      bb->bbTerm(child, current);
+      if (prod.empty())
+      {
+        prod = current;
+      }
+      else
+      {
+        std::vector<T> newprod;
+        shiftAddMultiplier(prod, current, newprod);
+        prod = newprod;
+      }
+    }
+    constantMultiplier(prod, c, res);
+    if (TraceIsOn("bitvector-bb"))
+    {
+      Trace("bitvector-bb") << "with bits: " << toString(res) << "\n";
+    }
+    return;
+  }
+
   std::vector<T> newres; 
   bb->bbTerm(node[0], res); 
   for(unsigned i = 1; i < node.getNumChildren(); ++i) {
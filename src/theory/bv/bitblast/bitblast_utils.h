@@ -20,6 +20,7 @@
 
 #include <ostream>
 #include "expr/node.h"
+#include "util/bitvector.h"
 
 namespace cvc5::internal {
 namespace theory {
@@ -218,6 +219,118 @@ inline void shiftAddMultiplier(const std::vector<T>&a, const std::vector<T>&b, s
   }
 }
 
+/**
+ * Full adder that does not create gates for inputs known to be constant, as
+ * the known-zero bits of shifted and zero-extended operands.
+ *
+ * @param sum the sum bit
+ * @return the carry-out
+ */
+template <class T>
+T inline constFullAdder(T a, T b, T carry, T& sum)
+{
+  unsigned ones = 0;
+  std::vector<T> in;
+  for (const T& x : {a, b, carry})
+  {
+    if (x == mkTrue<T>())
+    {
+      ++ones;
+    }
+    else if (x != mkFalse<T>())
+    {
+      in.push_back(x);
+    }
+  }
+  T parity = mkFalse<T>();
+  if (in.size() == 1)
+  {
+    parity = in[0];
+  }
+  else if (in.size() == 2)
+  {
+    parity = mkXor(in[0], in[1]);
+  }
+  else if (in.size() == 3)
+  {
+    parity = mkXor(mkXor(in[0], in[1]), in[2]);
+  }
+  if (ones % 2 == 1)
+  {
+    sum = in.empty() ? mkTrue<T>() : mkNot(parity);
+  }
+  else
+  {
+    sum = parity;
+  }
+  // the carry is set if at least two inputs are
+  if (ones >= 2) return mkTrue<T>();
+  if (ones == 1)
+  {
+    if (in.empty()) return mkFalse<T>();
+    return in.size() == 1 ? in[0] : mkOr(in[0], in[1]);
+  }
+  if (in.size() < 2) return mkFalse<T>();
+  if (in.size() == 2) return mkAnd(in[0], in[1]);
+  return mkOr(mkAnd(in[0], in[1]), mkAnd(mkXor(in[0], in[1]), in[2]));
+}
+
+/**
+ * Multiplies a by the constant c. The product is the sum of the shifted
+ * operands a << i over the non-zero digits of c in non-adjacent form
+ * (canonical signed digit recoding), where the operands of the digits -1 are
+ * subtracted. The NAF has at most (w + 1) / 2 non-zero digits, a run of ones
+ * in c costs one addition and one subtraction. Adding a << i leaves the low
+ * i bits unchanged, so each adder only covers the high w - i bits, and the
+ * known-zero bits of a (e.g., of a zero-extended operand) do not create
+ * gates.
+ *
+ * @param a the non-constant operand
+ * @param c the constant operand
+ * @param res the product
+ */
+template <class T>
+inline void constantMultiplier(const std::vector<T>& a,
+                               const BitVector& c,
+                               std::vector<T>& res)
+{
+  Assert(a.size() == c.getSize() && res.size() == 0);
+  unsigned w = a.size();
+  // NAF digits of c, a digit at position w vanishes modulo 2^w
+  std::vector<int> digits(w, 0);
+  Integer k = c.toInteger();
+  for (unsigned i = 0; i < w && !k.isZero(); ++i)
+  {
+    if (k.isBitSet(0))
+    {
+      digits[i] = k.isBitSet(1) ? -1 : 1;
+      k = digits[i] == 1 ? k - Integer(1) : k + Integer(1);
+    }
+    k = k.divByPow2(1);
+  }
+
+  makeZero(res, w);
+  for (unsigned i = 0; i < w; ++i)
+  {
+    if (digits[i] == 0) continue;
+    // res[i..w) += (-)a[0..w-i)
+    T carry = digits[i] == 1 ? mkFalse<T>() : mkTrue<T>();
+    for (unsigned j = i; j < w; ++j)
+    {
+      T b = a[j - i];
+      if (digits[i] == -1)
+      {
+        b = b == mkFalse<T>()  ? mkTrue<T>()
+            : b == mkTrue<T>() ? mkFalse<T>()
+                               : mkNot(b);
+      }
+      T sum;
+      carry = constFullAdder(res[j], b, carry, sum);
+      res[j] = sum;
+    }
+  }
+}
+
 template <class T>
 T inline uLessThanBB(const std::vector<T>&a, const std::vector<T>& b, bool orEqual) {
   Assert(a.size() && b.size());
@@ -63,6 +63,9 @@ class NodeBitblaster : public TBitblaster<Node>, protected EnvObj
   /** Checks whether node is a variable introduced via `makeVariable`.*/
   bool isVariable(TNode node);
 
+  /** Get the variables introduced via `makeVariable`. */
+  const TNodeSet& getVariables() const { return d_variables; }
+
   /**
    * Bit-blast `node` and return the result without applying any rewrites.
    *
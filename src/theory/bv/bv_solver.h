@@ -22,6 +22,7 @@
 
 #include "smt/env_obj.h"
 #include "theory/theory.h"
+#include "util/integer.h"
 
 namespace cvc5::internal {
 namespace theory {
@@ -111,6 +112,25 @@ class BVSolver : protected EnvObj
    */
   virtual Node getValue(TNode node, bool initialize) { return Node::null(); }
 
+  /**
+   * Get the model count computed by a model counting SAT back end
+   * (--blast-apxmc).
+   *
+   * @return false if no count was computed.
+   */
+  virtual bool getModelCount(Integer& count) { return false; }
+
+  /**
+   * Permanently add the constraint that the parity of the given 1-bit terms
+   * is `rhs` to the bit-level solver.
+   *
+   * @return false if this solver does not support bit-level constraints.
+   */
+  virtual bool assertBitXor(const std::vector<Node>& bits, bool rhs)
+  {
+    return false;
+  }
+
  protected:
   TheoryState& d_state;
   TheoryInferenceManager& d_im;
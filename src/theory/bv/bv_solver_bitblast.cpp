@@ -15,7 +15,10 @@
 
 #include "theory/bv/bv_solver_bitblast.h"
 
+#include <algorithm>
+
 #include "options/bv_options.h"
+#include "options/counting_options.h"
 #include "prop/sat_solver_factory.h"
 #include "theory/bv/theory_bv.h"
 #include "theory/bv/theory_bv_utils.h"
@@ -124,7 +127,10 @@ BVSolverBitblast::BVSolverBitblast(Env& env,
       d_factLiteralCache(context()),
       d_literalFactCache(context()),
       d_propagate(options().bv.bitvectorPropagate),
-      d_resetNotify(new NotifyResetAssertions(userContext()))
+      d_resetNotify(new NotifyResetAssertions(userContext())),
+      d_xors(userContext()),
+      d_numXors(0),
+      d_hasPoppedXors(false)
 {
   if (env.isTheoryProofProducing())
   {
@@ -149,11 +155,10 @@ void BVSolverBitblast::postCheck(Theory::Effort level)
   // were reset, we have to reset the SAT solver and the CNF stream.
   if (options().bv.bvAssertInput && d_resetNotify->doneResetAssertions())
   {
-    d_satSolver.reset(nullptr);
-    d_cnfStream.reset(nullptr);
-    initSatSolver();
+    resetSatSolver();
     d_resetNotify->reset();
   }
+  dropPoppedXors();
 
   NodeManager* nm = NodeManager::currentNM();
 
@@ -206,6 +211,13 @@ void BVSolverBitblast::postCheck(Theory::Effort level)
     d_assumptions.push_back(d_factLiteralCache[fact]);
   }
 
+  if (options().bv.bvSatSolver == options::SatSolverMode::APPROXMC
+      || options().bv.bvSatSolver == options::SatSolverMode::EXACTMC
+      || options().bv.bvSatSolver == options::SatSolverMode::DUMP)
+  {
+    setSamplingSet();
+  }
+
   std::vector<prop::SatLiteral> assumptions(d_assumptions.begin(),
                                             d_assumptions.end());
   prop::SatValue val = d_satSolver->solve(assumptions);
@@ -340,6 +352,16 @@ void BVSolverBitblast::initSatSolver()
           d_env.getResourceManager(),
           "theory::bv::BVSolverBitblast::"));
       break;
+    case options::SatSolverMode::EXACTMC:
+      d_satSolver.reset(prop::SatSolverFactory::createExactCounter(
+          statisticsRegistry(), "theory::bv::BVSolverBitblast::"));
+      break;
+    case options::SatSolverMode::DUMP:
+      d_satSolver.reset(prop::SatSolverFactory::createCnfDumper(
+          statisticsRegistry(),
+          options().counting.dumpCountingCnf,
+          "theory::bv::BVSolverBitblast::"));
+      break;
     default:
       d_satSolver.reset(prop::SatSolverFactory::createCadical(
           statisticsRegistry(),
@@ -354,6 +376,138 @@ void BVSolverBitblast::initSatSolver()
                                         "theory::bv::BVSolverBitblast"));
 }
 
+void BVSolverBitblast::setSamplingSet()
+{
+  const std::string& prefix = options().counting.projprefix;
+  bool projected = options().counting.projcount;
+  auto inProjection = [&](TNode var) {
+    if (!projected) return true;
+    return var.hasName() && var.getName().compare(0, prefix.size(), prefix) == 0;
+  };
+
+  std::vector<prop::SatVariable> samplingSet;
+  for (TNode var : d_bitblaster->getVariables())
+  {
+    if (!inProjection(var) || !d_bitblaster->hasBBTerm(var))
+    {
+      continue;
+    }
+    std::vector<Node> bits;
+    d_bitblaster->getBBTerm(var, bits);
+    for (const Node& bit : bits)
+    {
+      // Bits that do not occur in any clause yet still have to be counted.
+      d_cnfStream->ensureLiteral(bit);
+      samplingSet.push_back(d_cnfStream->getLiteral(bit).getSatVariable());
+    }
+  }
+  // In eager bitblast mode the Boolean variables are in the CNF stream too.
+  if (options().bv.bitblastMode == options::BitblastMode::EAGER)
+  {
+    std::vector<TNode> bvars;
+    d_cnfStream->getBooleanVariables(bvars);
+    for (TNode var : bvars)
+    {
+      if (inProjection(var))
+      {
+        samplingSet.push_back(d_cnfStream->getLiteral(var).getSatVariable());
+      }
+    }
+  }
+  // Keep the sampling set, and with it the hashes of the counter, independent
+  // of the iteration order of the variable set.
+  std::sort(samplingSet.begin(), samplingSet.end());
+  Trace("bv-bitblast") << "sampling set: " << samplingSet.size()
+                       << " variables" << std::endl;
+  d_satSolver->setSamplingSet(samplingSet);
+}
+
+bool BVSolverBitblast::getModelCount(Integer& count)
+{
+  return d_satSolver->getModelCount(count);
+}
+
+bool BVSolverBitblast::assertBitXor(const std::vector<Node>& bits, bool rhs)
+{
+  // XOR constraints popped since the last one must not outlive the reset
+  // that drops them, so they are dealt with before this one is added.
+  dropPoppedXors();
+  BitXor x;
+  for (const Node& bit : bits)
+  {
+    Assert(utils::getSize(bit) == 1);
+    std::vector<Node> bb;
+    d_bitblaster->bbTerm(bit, bb);
+    x.bits.push_back(bb[0]);
+  }
+  x.rhs = rhs;
+  Trace("bv-bitblast") << "assert xor over " << x.bits.size()
+                       << " bits = " << rhs << std::endl;
+  d_xors.push_back(x);
+  d_numXors = d_xors.size();
+  addXor(x);
+  return true;
+}
+
+void BVSolverBitblast::addXor(const BitXor& x)
+{
+  if (d_satSolver->nativeXor())
+  {
+    prop::SatClause clause;
+    for (const Node& bb : x.bits)
+    {
+      d_cnfStream->ensureLiteral(bb);
+      clause.push_back(d_cnfStream->getLiteral(bb));
+    }
+    d_satSolver->addXorClause(clause, x.rhs, false);
+    return;
+  }
+
+  NodeManager* nm = NodeManager::currentNM();
+  Node parity = nm->mkConst(false);
+  for (const Node& bb : x.bits)
+  {
+    parity = nm->mkNode(kind::XOR, parity, bb);
+  }
+  d_cnfStream->convertAndAssert(
+      x.rhs ? parity : parity.notNode(), false, false);
+}
+
+void BVSolverBitblast::dropPoppedXors()
+{
+  // The XOR constraints stay in the SAT solver when they are popped from
+  // d_xors, which only loses entries at its end.
+  if (d_xors.size() < d_numXors)
+  {
+    d_hasPoppedXors = true;
+  }
+  d_numXors = d_xors.size();
+  // Starting over with a fresh SAT solver is only possible if no SAT literal
+  // of the current one is cached for the remaining context levels.
+  // Otherwise the popped constraints stay until a later call.
+  if (!d_hasPoppedXors || !d_factLiteralCache.empty()
+      || !d_assumptions.empty() || !d_assertions.empty())
+  {
+    return;
+  }
+  Trace("bv-bitblast") << "reset SAT solver to drop popped xors" << std::endl;
+  resetSatSolver();
+}
+
+void BVSolverBitblast::resetSatSolver()
+{
+  d_satSolver.reset(nullptr);
+  d_cnfStream.reset(nullptr);
+  initSatSolver();
+  // The XOR constraints that were not popped are added again
+  for (const BitXor& x : d_xors)
+  {
+    addXor(x);
+  }
+  d_numXors = d_xors.size();
+  d_hasPoppedXors = false;
+}
+
 Node BVSolverBitblast::getValue(TNode node, bool initialize)
 {
   if (node.isConst())
@@ -77,10 +77,50 @@ class BVSolverBitblast : public BVSolver
    */
   Node getValue(TNode node, bool initialize) override;
 
+  bool getModelCount(Integer& count) override;
+
+  /**
+   * Add the parity constraint over the bit-blasted `bits` to the SAT back
+   * end, as a native XOR clause if the back end supports it and as its CNF
+   * otherwise. The constraint belongs to the current user-context level.
+   * It stays in the SAT solver after it is popped, until the SAT solver is
+   * rebuilt with the remaining constraints (see dropPoppedXors()).
+   */
+  bool assertBitXor(const std::vector<Node>& bits, bool rhs) override;
+
  private:
   /** Initialize SAT solver and CNF stream.  */
   void initSatSolver();
 
+  /**
+   * Replace the SAT solver and CNF stream by fresh ones, with the XOR
+   * constraints of the current user context.
+   */
+  void resetSatSolver();
+
+  /** An XOR constraint of assertBitXor() over bit-blasted bits. */
+  struct BitXor
+  {
+    std::vector<Node> bits;
+    bool rhs;
+  };
+
+  /** Add an XOR constraint to the current SAT solver. */
+  void addXor(const BitXor& x);
+
+  /**
+   * Rebuild the SAT solver without the XOR constraints that were popped, if
+   * there are any and no SAT literal is cached. Called before an XOR
+   * constraint is added and at every check.
+   */
+  void dropPoppedXors();
+
+  /**
+   * Pass the SAT variables of the bits of the projection variables
+   * (--projcount/--projprefix) to the model counting SAT back end.
+   */
+  void setSamplingSet();
+
   /**
    * Handle BITVECTOR_EAGER_ATOM atoms and assert/assume to CnfStream.
    *
@@ -138,6 +178,15 @@ class BVSolverBitblast : public BVSolver
 
   /** Notifies when reset-assertion was called. */
   std::unique_ptr<NotifyResetAssertions> d_resetNotify;
+
+  /** The XOR constraints of the current user context, in order. */
+  context::CDList<BitXor> d_xors;
+
+  /** The size of d_xors when it was last compared with the SAT solver. */
+  size_t d_numXors;
+
+  /** Whether the SAT solver has XOR constraints that were popped. */
+  bool d_hasPoppedXors;
 };
 
 }  // namespace bv
@@ -318,6 +318,16 @@ EqualityStatus TheoryBV::getEqualityStatus(TNode a, TNode b)
   return status;
 }
 
+bool TheoryBV::getModelCount(Integer& count)
+{
+  return d_internal->getModelCount(count);
+}
+
+bool TheoryBV::assertBitXor(const std::vector<Node>& bits, bool rhs)
+{
+  return d_internal->assertBitXor(bits, rhs);
+}
+
 TrustNode TheoryBV::explain(TNode node) { return d_internal->explain(node); }
 
 void TheoryBV::notifySharedTerm(TNode t)
@@ -95,6 +95,20 @@ class TheoryBV : public Theory
 
   EqualityStatus getEqualityStatus(TNode a, TNode b) override;
 
+  /**
+   * Get the model count computed by the bit-blasting solver if it uses a
+   * model counting SAT back end (--blast-apxmc).
+   *
+   * @return false if no count was computed.
+   */
+  bool getModelCount(Integer& count);
+
+  /**
+   * Assert that the parity of the given 1-bit terms is `rhs` at the bit level
+   * (see BVSolver::assertBitXor).
+   */
+  bool assertBitXor(const std::vector<Node>& bits, bool rhs);
+
  private:
   void notifySharedTerm(TNode t) override;
 
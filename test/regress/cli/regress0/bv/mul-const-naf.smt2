@@ -0,0 +1,16 @@
+(set-logic QF_BV)
+(set-info :status unsat)
+(declare-fun x () (_ BitVec 16))
+(declare-fun y () (_ BitVec 8))
+(declare-fun z () (_ BitVec 4))
+; 0x70ff = 2^15 - 2^12 + 2^8 - 1
+(assert (or (not (= (bvmul x (_ bv28927 16))
+                    (bvsub (bvadd (bvshl x (_ bv15 16)) (bvshl x (_ bv8 16)))
+                           (bvadd (bvshl x (_ bv12 16)) x))))
+            ; 7 * 183 = 1 mod 2^8
+            (and (= (bvmul y (_ bv7 8)) (_ bv1 8))
+                 (not (= y (_ bv183 8))))
+            ; known-zero high bits of the zero-extended operand
+            (and (= (bvmul (_ bv13 12) ((_ zero_extend 8) z)) (_ bv117 12))
+                 (not (= z (_ bv9 4))))))
+(check-sat)
@@ -0,0 +1,11 @@
+; COMMAND-LINE: -S --seed=6 --auto-slicesize --auto-slicesize-budget=400
+; SCRUBBER: awk '/slice size probe:/ {p++} /using slice size/ {u = 1} /hashes active: [1-9]/ {h = 1} /^s mc/ {print (p > 1 && u && h && $3 >= 1707 && $3 <= 5529) ? "probed and hashed count in range" : $0}'
+; EXPECT: probed and hashed count in range
+; The slice size picked depends on timing, but any of them must give a count
+; within a factor 1.8 of the 3072 solutions
+(set-logic QF_BV)
+(declare-fun x () (_ BitVec 12))
+(declare-fun y () (_ BitVec 8))
+(assert (bvult x #x400))
+(assert (bvult y #x03))
+(check-sat)
@@ -0,0 +1,18 @@
+; COMMAND-LINE: --blast-exactmc
+; SCRUBBER: grep "^s mc"
+; EXPECT: s mc 1065369600
+; Two adders and comparators of 8 bits bit-blast to a few hundred variables.
+; Each of them has 256 * 255 / 2 = 32640 solutions, with z and w determined
+; by the others, and they share no variable.
+(set-logic QF_BV)
+(declare-fun x () (_ BitVec 8))
+(declare-fun y () (_ BitVec 8))
+(declare-fun z () (_ BitVec 8))
+(declare-fun u () (_ BitVec 8))
+(declare-fun v () (_ BitVec 8))
+(declare-fun w () (_ BitVec 8))
+(assert (bvult x y))
+(assert (= z (bvadd x y)))
+(assert (bvult u v))
+(assert (= w (bvadd u v)))
+(check-sat)
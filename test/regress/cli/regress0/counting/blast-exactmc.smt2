@@ -0,0 +1,11 @@
+; COMMAND-LINE: --blast-exactmc
+; COMMAND-LINE: -e
+; SCRUBBER: grep "^s mc"
+; EXPECT: s mc 74
+; The exact count of the bit-blasted CNF agrees with the enumeration, also
+; for a disjunction that has no single propositional model.
+(set-logic QF_BV)
+(declare-fun x () (_ BitVec 4))
+(declare-fun y () (_ BitVec 4))
+(assert (or (= x #x1) (= x #x2) (bvult y #x3)))
+(check-sat)
@@ -0,0 +1,16 @@
+; COMMAND-LINE: -S --count-budget=1
+; SCRUBBER: grep -o -e "counting stopped by --count-budget" -e "No round of count 0 finished before it was stopped by --count-budget"
+; EXPECT: counting stopped by --count-budget
+; EXPECT: No round of count 0 finished before it was stopped by --count-budget
+; EXIT: 1
+; Factoring the product of a 31-bit and a 32-bit prime takes far longer than
+; the budget, so the first round is cut in its first bounded count and there
+; is no count to report
+(set-logic QF_BV)
+(declare-fun x () (_ BitVec 32))
+(declare-fun y () (_ BitVec 32))
+(assert (bvugt x #x00000001))
+(assert (bvugt y #x00000001))
+(assert (= (bvmul ((_ zero_extend 32) x) ((_ zero_extend 32) y))
+           #x200065d531f2a897))
+(check-sat)
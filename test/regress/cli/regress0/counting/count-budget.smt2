@@ -0,0 +1,12 @@
+; COMMAND-LINE: -S --seed=14 --count-budget=600
+; SCRUBBER: awk '/hashes active: [1-9]/ {h = 1} /count within epsilon 0.8 / {print $1, $2, $3, $4, $5, $6} /^s mc/ {print (h && $3 >= 6965 && $3 <= 22567) ? "hashed count in range" : $0}'
+; EXPECT: c [smtappmc] count within epsilon 0.8
+; EXPECT: hashed count in range
+; All rounds finish long before the budget runs out, so the count is not
+; partial and must be within a factor 1.8 of the 12537 solutions
+(set-logic QF_BV)
+(declare-fun x () (_ BitVec 11))
+(declare-fun y () (_ BitVec 3))
+(assert (bvugt x #b00100000000))
+(assert (distinct y #b000))
+(check-sat)
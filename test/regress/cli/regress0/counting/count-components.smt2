@@ -0,0 +1,19 @@
+; COMMAND-LINE: -S --seed=9 --count-components
+; SCRUBBER: awk '/counting component/ {h = 0} /hashes active: [1-9]/ {h = 1} /component [12] count:/ {n += h} /^s mc/ {print (n == 2 && $3 >= 141667 && $3 <= 459000) ? "hashed components in range" : $0}'
+; EXPECT: hashed components in range
+; x has 1000 values and the Booleans 255, both above the per component pivot
+; of 191, so each component is hashed on its own and the product must be
+; within a factor 1.8 of the 255000 solutions
+(set-logic QF_BV)
+(declare-fun x () (_ BitVec 10))
+(declare-fun a () Bool)
+(declare-fun b () Bool)
+(declare-fun c () Bool)
+(declare-fun d () Bool)
+(declare-fun e () Bool)
+(declare-fun f () Bool)
+(declare-fun g () Bool)
+(declare-fun h () Bool)
+(assert (bvult x #b1111101000))
+(assert (or a b c d e f g h))
+(check-sat)
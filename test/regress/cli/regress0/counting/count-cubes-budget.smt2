@@ -0,0 +1,14 @@
+; COMMAND-LINE: -S --count-cubes=2 --count-budget=1
+; SCRUBBER: grep "cubes stopped by\|^s mc"
+; EXPECT: c [smtappmc] cubes stopped by --count-budget, the partial count leaves out the cubes not counted
+; EXPECT: s mc 0
+; Factoring the product of two 31-bit primes takes far longer than the
+; budget, so the first cube has no finished round and the partial sum is 0
+(set-logic QF_BV)
+(declare-fun x () (_ BitVec 32))
+(declare-fun y () (_ BitVec 32))
+(assert (bvugt x #x00000001))
+(assert (bvugt y #x00000001))
+(assert (= (bvmul ((_ zero_extend 32) x) ((_ zero_extend 32) y))
+           #x3ff85eccd8831523))
+(check-sat)
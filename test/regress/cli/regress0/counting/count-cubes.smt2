@@ -0,0 +1,13 @@
+; COMMAND-LINE: -S --seed=10 --count-cubes=4
+; COMMAND-LINE: -S --seed=10 --count-cubes=4 --count-threads=2
+; SCRUBBER: awk '/hashes active: [1-9]/ {h = 1} /cube [0-3] count:/ {n++} /^s mc/ {print (h && n == 4 && $3 >= 5334 && $3 <= 17280) ? "hashed cubes in range" : $0}'
+; EXPECT: hashed cubes in range
+; The cubes on the top bits of x and y have 4096, 2304, 2048 and 1152
+; solutions, all above the pivot, and their sum must be within a factor 1.8
+; of the 9600 solutions
+(set-logic QF_BV)
+(declare-fun x () (_ BitVec 10))
+(declare-fun y () (_ BitVec 4))
+(assert (bvult x #b1100100000))
+(assert (bvule y #xb))
+(check-sat)
@@ -0,0 +1,13 @@
+; COMMAND-LINE: -S --seed=13 --count-resume-from=count-resume-active.ckpt --count-resume=/tmp/pact-count-resume-active.ckpt
+; SCRUBBER: awk '/continuing count/ {print} /hashes active: [1-9]/ {h = 1} /^s mc/ {print (h && $3 >= 3414 && $3 <= 11059) ? "hashed count in range" : $0}'; rm -f /tmp/pact-count-resume-active.ckpt
+; EXPECT: c [smtappmc] continuing count 0 from 2 finished rounds and a round in progress
+; EXPECT: hashed count in range
+; The checkpoint is the one of a run killed in its third round, at the step
+; with 2 hashes of the search and with two solutions of that round found. The
+; round is continued with the hashes drawn again from its seed, and the count
+; of the 6144 solutions must be within a factor 1.8
+(set-logic QF_BV)
+(declare-fun x () (_ BitVec 12))
+(declare-fun b () Bool)
+(assert (or b (bvult x #x800)))
+(check-sat)
@@ -0,0 +1,11 @@
+; COMMAND-LINE: -S --count-resume=count-resume-mismatch.ckpt
+; SCRUBBER: grep -o "was made with different settings"
+; EXPECT: was made with different settings
+; EXIT: 1
+; The checkpoint was made with --epsilon=0.5, so it is not resumed
+(set-logic QF_BV)
+(declare-fun x () (_ BitVec 4))
+(declare-fun b () Bool)
+(assert (bvult x #x5))
+(assert (or b (bvult x #x3)))
+(check-sat)
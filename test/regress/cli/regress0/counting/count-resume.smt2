@@ -0,0 +1,11 @@
+; COMMAND-LINE: -S --seed=12 --count-resume=/tmp/pact-count-resume.ckpt
+; SCRUBBER: awk '/hashes active: [1-9]/ {h = 1} /^s mc/ {print (h && $3 >= 18276 && $3 <= 59212) ? "hashed count in range" : $0}'; grep -q "^unit 0 " /tmp/pact-count-resume.ckpt && echo "checkpoint has the count"; rm -f /tmp/pact-count-resume.ckpt
+; EXPECT: hashed count in range
+; EXPECT: checkpoint has the count
+; Without a checkpoint to resume, the run counts the 32896 solutions from
+; scratch and keeps the finished count in the checkpoint
+(set-logic QF_BV)
+(declare-fun x () (_ BitVec 8))
+(declare-fun y () (_ BitVec 8))
+(assert (bvule x y))
+(check-sat)
@@ -0,0 +1,11 @@
+; COMMAND-LINE: -S --seed=2 --count-threads=2
+; SCRUBBER: awk '/hashes active: [1-9]/ {h = 1} /^s mc/ {print (h && $3 >= 1312 && $3 <= 4248) ? "hashed count in range" : $0}'
+; EXPECT: hashed count in range
+; The workers hash, and the median of their rounds is within a factor 1.8
+; of the 2360 solutions
+(set-logic QF_BV)
+(declare-fun x () (_ BitVec 8))
+(declare-fun y () (_ BitVec 4))
+(assert (bvuge x #x14))
+(assert (bvule y #x9))
+(check-sat)
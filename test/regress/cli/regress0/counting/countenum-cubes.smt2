@@ -0,0 +1,9 @@
+; COMMAND-LINE: -e
+; SCRUBBER: grep "^s mc"
+; EXPECT: s mc 300
+(set-logic QF_BV)
+(declare-fun x () (_ BitVec 8))
+(declare-fun b () Bool)
+(assert (bvult x #xc8))
+(assert (or b (= ((_ extract 0 0) x) #b1)))
+(check-sat)
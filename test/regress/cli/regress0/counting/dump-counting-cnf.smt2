@@ -0,0 +1,11 @@
+; COMMAND-LINE: --dump-counting-cnf=-
+; SCRUBBER: awk '/^p cnf/ { n = $4 } /^-?[0-9]/ { c++ } /^c p show/ { s = NF - 4 } END { print "show " s; print (c == n ? "clause count matches" : "clause count differs") }'
+; EXPECT: show 4
+; EXPECT: clause count matches
+; The whole disjunction is dumped, not the facts of one of its models
+(set-logic QF_BV)
+(declare-fun x () (_ BitVec 2))
+(declare-fun y () (_ BitVec 2))
+(assert (or (= x #b01) (= x #b10)))
+(assert (bvule y x))
+(check-sat)
@@ -0,0 +1,10 @@
+; COMMAND-LINE: -S --seed=1 --epsilon=0.5 --delta=0.1
+; SCRUBBER: awk '/\] epsilon:/ {print $3, $4, $5, $6} /hashes active: [1-9]/ {h = 1} /^s mc/ {print (h && $3 >= 1334 && $3 <= 3000) ? "hashed count in range" : $0}'
+; EXPECT: epsilon: 0.5 delta: 0.1
+; EXPECT: hashed count in range
+; 2000 solutions are well above the pivot of epsilon 0.5, so the rounds hash,
+; and the count is within a factor 1.5 of 2000
+(set-logic QF_BV)
+(declare-fun x () (_ BitVec 12))
+(assert (bvult x (_ bv2000 12)))
+(check-sat)
@@ -0,0 +1,13 @@
+; COMMAND-LINE: -S --seed=8
+; SCRUBBER: awk '/hashes active: [1-9]/ {h = 1} /^s mc/ {print (h && $3 >= 7965 && $3 <= 25806) ? "hashed count in range" : $0}'
+; EXPECT: hashed count in range
+; The positive normal half-precision values below 1 are the 14 binades of
+; exponent 1 to 14 with 1024 values each, and the NaN encodings count as
+; one more value, so the rounds hash over 14337 solutions
+(set-logic QF_FP)
+(declare-fun f () (_ FloatingPoint 5 11))
+(assert (or (fp.isNaN f)
+            (and (fp.isNormal f)
+                 (fp.isPositive f)
+                 (fp.lt f (fp #b0 #b01111 #b0000000000)))))
+(check-sat)
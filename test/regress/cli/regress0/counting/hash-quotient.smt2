@@ -0,0 +1,10 @@
+; COMMAND-LINE: -S --seed=4
+; COMMAND-LINE: -S --seed=4 --hash-quotient
+; SCRUBBER: awk '/hashes active: [1-9]/ {h = 1} /^s mc/ {print (h && $3 >= 1707 && $3 <= 5529) ? "hashed count in range" : $0}'
+; EXPECT: hashed count in range
+; Both encodings of the reduction modulo p define the same cells for the same
+; seed, and both counts must be within a factor 1.8 of the 3072 solutions
+(set-logic QF_BV)
+(declare-fun x () (_ BitVec 12))
+(assert (not (= ((_ extract 1 0) x) #b00)))
+(check-sat)
@@ -0,0 +1,10 @@
+; REQUIRES: cocoa
+; COMMAND-LINE: -S --seed=5 --hashsm=ff
+; SCRUBBER: awk '/hashes active: [1-9]/ {h = 1} /^s mc/ {print (h && $3 >= 112 && $3 <= 360) ? "hashed count in range" : $0}'
+; EXPECT: hashed count in range
+; 200 solutions are above the pivot, so the rounds solve linear equations
+; over the field copies of the 10 projection bits
+(set-logic QF_BV)
+(declare-fun x () (_ BitVec 10))
+(assert (bvult x (_ bv200 10)))
+(check-sat)
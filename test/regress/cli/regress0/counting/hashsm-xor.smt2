@@ -0,0 +1,12 @@
+; COMMAND-LINE: -S --seed=3 --hashsm=xor
+; SCRUBBER: awk '/hashes active: [1-9]/ {h = 1} /^s mc/ {print (h && $3 >= 1138 && $3 <= 3686) ? "hashed count in range" : $0}'
+; EXPECT: hashed count in range
+; Every round adds its XORs right after the ones of the previous round were
+; popped. A new XOR dropped together with the popped ones would double the
+; count of its round, so the median of the rounds would no longer be within
+; a factor 1.8 of the 2048 solutions.
+(set-logic QF_BV)
+(declare-fun a () (_ BitVec 6))
+(declare-fun b () (_ BitVec 6))
+(assert (bvult (bvadd a b) #b100000))
+(check-sat)
@@ -0,0 +1,10 @@
+; COMMAND-LINE: -S
+; SCRUBBER: grep "^s mc\|are empty"
+; EXPECT: c [smtappmc] the bounds of Integer x are empty
+; EXPECT: s mc 0
+(set-logic QF_LIA)
+(declare-fun x () Int)
+(declare-fun y () Int)
+(assert (and (<= 5 x) (< x 5)))
+(assert (and (<= 0 y) (<= y 3)))
+(check-sat)
@@ -0,0 +1,12 @@
+; COMMAND-LINE: -S --seed=7
+; SCRUBBER: awk '/hashes active: [1-9]/ {h = 1} /^s mc/ {print (h && $3 >= 1051 && $3 <= 3403) ? "hashed count in range" : $0}'
+; EXPECT: hashed count in range
+; The 1891 solutions are above the pivot, so the rounds hash the Integers
+; with linear equations modulo a prime
+(set-logic QF_LIA)
+(declare-fun x () Int)
+(declare-fun y () Int)
+(assert (and (<= 0 x) (<= x 60)))
+(assert (and (<= 0 y) (<= y 60)))
+(assert (<= (+ x y) 60))
+(check-sat)
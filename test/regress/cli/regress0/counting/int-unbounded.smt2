@@ -0,0 +1,11 @@
+; COMMAND-LINE: -S
+; SCRUBBER: grep -o "cannot infer bounds of the projection variable y"
+; EXPECT: cannot infer bounds of the projection variable y
+; EXIT: 1
+; Without --projcount every Integer is projected, and y has no upper bound
+(set-logic QF_LIA)
+(declare-fun x () Int)
+(declare-fun y () Int)
+(assert (and (<= 0 x) (<= x 3)))
+(assert (<= x y))
+(check-sat)